@@ -24,6 +24,11 @@ function run_example(mh)
     % input switches
     options.sw_SR_COSMOfiles_type = "ORCA_COSMO_TZVPD";                 % ['Turbomole_COSMO_TZVP', 'Turbomole_COSMO_TZVPD_FINE', 'ORCA_COSMO_TZVPD']
     options.sw_SR_combTerm = 2;
+    options.sw_SR_moleculeCacheDirectory = "";                              % existing directory to cache the parsed COSMOfiles and segment profiles as binary files, "" to deactivate
+    options.sw_SR_moleculeLibraryPath = "";                                 % molecule library written with openCOSMORS --createMoleculeLibrary, if set the components are molecule names
+    options.sw_SR_extendedSigmaProfileDirectory = "";                       % existing directory to write the extended sigma profiles (.extsp) to, "" to deactivate
+    options.sw_SR_deduplicateMolecules = 1;                                 % [0, 1] : 1 loads components with identical content only once and shares the molecule
+    options.sw_SR_loadMoleculesOnDemand = 0;                                % [0, 1] : 1 loads a molecule only when a calculation referring to it is loaded
 
     % optional calculation switches
     options.sw_SR_alwaysReloadSigmaProfiles = 1;                            % Whether to reload the sigma profiles on every calculation
@@ -33,6 +38,8 @@ function run_example(mh)
                                                                             % 1  =  calculate contact statistics and average surface energies
                                                                             % 2  =  calculate contact statistics; average surface energies and partial molar properties
     options.sw_SR_partialInteractionMatrices = {};                          % e.g. {'E_mf', 'G_hb'}, these need to be specified in the C++ function "calculateInteractionMatrix"
+    options.sw_SR_reuseSolvedStates = 1;                                    % [0, 1] : solve states occuring in more than one calculation only once
+    options.sw_SR_singlePrecisionSegmentDistances = 0;                      % [0, 1] : 1 keeps the segment distances for reloading the sigma profiles in single precision
 
     % segment descriptor switches
     options.sw_SR_atomicNumber = 0;                                         % [0, 1] : differentiate between atomic numbers
@@ -41,6 +48,9 @@ function run_example(mh)
                                                                             % 2  =  use misfit correlation only on neutral molecules
     options.sw_SR_differentiateHydrogens = 0;                               % [0, 1] : differentiate between hydrogen atoms depending on the heteroatom they are bound to
     options.sw_SR_differentiateMoleculeGroups = 0;                          % [0, 1] : differentiate between molecule groups
+    options.sw_SR_mergeEquivalentSegmentTypes = 1;                          % [0, 1] : merge segment types that only differ in descriptors not used in the interaction matrix
+    options.sw_SR_sigmaAveragingWeightCutoff = 0;                           % [0, 1) : gaussian weights of the sigma averaging below this relative value are neglected, 0 uses all segment pairs
+    options.sw_SR_sigmaGridCoarseningFactor = 1;                            % [1, 2, 3, ...] : multiple of the sigma step used to cluster the segments, has to divide the 300 sigma steps
 
     %% parameters
     parameters.Aeff =  6.25;
@@ -16,6 +16,12 @@ options = {
                                                                     # you still need to catch the error and handle it approprietlywhether to skip COSMOSPACE errors in the case a parameter makes the equations unsolvable
     # input switches
     'sw_SR_COSMOfiles_type': 'ORCA_COSMO_TZVPD',                # ['Turbomole_COSMO_TZVP', 'Turbomole_COSMO_TZVPD_FINE', 'ORCA_COSMO_TZVPD']
+    'sw_SR_moleculeCacheDirectory': '',                             # existing directory to cache the parsed COSMOfiles and segment profiles as binary files, '' to deactivate
+    'sw_SR_moleculeLibraryPath': '',                                # molecule library written by openCOSMORS.createMoleculeLibrary, if set componentPaths are molecule names
+    'sw_SR_extendedSigmaProfileDirectory': '',                      # existing directory to write the extended sigma profiles (.extsp) to, '' to deactivate
+                                                                    # componentPaths ending in .extsp are read as extended sigma profiles
+    'sw_SR_deduplicateMolecules': 1,                                # [0, 1] : 1 loads component paths with identical content only once and shares the molecule
+    'sw_SR_loadMoleculesOnDemand': 0,                               # [0, 1] : 1 loads a molecule only when a calculation referring to it is loaded
     'sw_SR_combTerm': 1, # 0 No combinatorial term
                          # 1 to use the combinatorial term by Staverman-Guggenheim
                          # 2 to use the combinatorial term by Klamt (2003)
@@ -23,6 +29,8 @@ options = {
 
     # optional calculation switches
     'sw_SR_alwaysReloadSigmaProfiles': 0,
+    'sw_SR_singlePrecisionSegmentDistances': 0,                     # [0, 1] : 1 keeps the segment distances for reloading the sigma profiles in single precision,
+                                                                    #          halving their memory
     'sw_SR_alwaysCalculateSizeRelatedParameters': 1,
     'sw_SR_useSegmentReferenceStateForInteractionMatrix': 0,        # [0, 1] 
                                                                     #       0 : conductor
@@ -33,6 +41,8 @@ options = {
                                                                     #       2 : calculate contact statistics, average surface energies and partial molar properties
     'sw_SR_partialInteractionMatrices' : [],                        # partial interaction matrices to be calculated as partial mlar properties
                                                                     # examples are ['E_mf', 'G_hb'], these must however also be added on the C++ side
+    'sw_SR_reuseSolvedStates': 1,                                   # [0, 1] : solve states occuring in more than one calculation only once,
+                                                                    #          e.g. pure component reference states. Not used with contact statistics
     
                                                                   
     # segment descriptor switches
@@ -43,6 +53,12 @@ options = {
                                                                     #       2 : use misfit correlation only on neutral molecules
     'sw_SR_differentiateHydrogens' : 0,                             # [0, 1] : differentiate between hydrogen atoms depending on the heteroatom they are bound to
     'sw_SR_differentiateMoleculeGroups' : 0,                        # [0, 1] : differentiate between molecule groups
+    'sw_SR_mergeEquivalentSegmentTypes' : 1,                        # [0, 1] : merge segment types that only differ in descriptors not used in the interaction matrix
+    'sw_SR_sigmaAveragingWeightCutoff' : 0,                         # [0, 1) : gaussian weights of the sigma averaging below this relative value are neglected,
+                                                                    #          0 uses all segment pairs. Speeds up loading of large molecules
+    'sw_SR_sigmaGridCoarseningFactor' : 1,                          # [1, 2, 3, 4, 5, 6, ...] : multiple of the sigma step used to cluster the segments, has to divide
+                                                                    #               the 300 sigma steps. Larger values reduce the number of segment types
+                                                                    #               at the cost of accuracy (e.g. first screenings)
 
 }
 
@@ -5,25 +5,525 @@
 
 
 #pragma once
-#include <stdarg.h>
 #include <string>
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 #include "helper_functions.hpp"
 
-#define NUM_ARGS(...) std::tuple_size<decltype(std::make_tuple(__VA_ARGS__))>::value
-#define parse_line(haystack, format, ...)  (_parse_line(NUM_ARGS(__VA_ARGS__), haystack, format,  __VA_ARGS__))
+#if defined(USE_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(USE_ZSTD)
+#include <zstd.h>
+#endif
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// read-only view of a complete file mapped into memory
+class memoryMappedFile {
+
+    const char* data = nullptr;
+    size_t size = 0;
+    bool opened = false;
+
+#if defined(_WIN32)
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = NULL;
+#endif
+
+public:
+    memoryMappedFile(const std::string& path) {
+#if defined(_WIN32)
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize))
+            return;
+        size = size_t(fileSize.QuadPart);
+        opened = true;
+
+        // empty files can not be mapped
+        if (size == 0)
+            return;
+
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mappingHandle != NULL)
+            data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+        int fileDescriptor = open(path.c_str(), O_RDONLY);
+        if (fileDescriptor == -1)
+            return;
+
+        struct stat fileStatus;
+        if (fstat(fileDescriptor, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode)) {
+            size = size_t(fileStatus.st_size);
+            opened = true;
+
+            // empty files can not be mapped
+            if (size > 0) {
+                void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+                if (mapping != MAP_FAILED)
+                    data = (const char*)mapping;
+            }
+        }
+        // the mapping stays valid after closing the file descriptor
+        close(fileDescriptor);
+#endif
+        if (size > 0 && data == nullptr)
+            opened = false;
+    }
+
+    ~memoryMappedFile() {
+#if defined(_WIN32)
+        if (data != nullptr)
+            UnmapViewOfFile(data);
+        if (mappingHandle != NULL)
+            CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(fileHandle);
+#else
+        if (data != nullptr)
+            munmap((void*)data, size);
+#endif
+    }
+
+    memoryMappedFile(const memoryMappedFile&) = delete;
+    memoryMappedFile& operator=(const memoryMappedFile&) = delete;
+
+    bool isOpen() const { return opened; }
+    const char* begin() const { return data; }
+    const char* end() const { return data + size; }
+};
+
+// Text of a COSMOfile, uncompressed files are mapped into memory, gzip and zstd compressed files are recognized
+// by their magic bytes and decompressed chunk by chunk from the mapped file into memory without a temporary file.
+// Decompression is available if the code is compiled with USE_ZLIB (gzip) or USE_ZSTD (zstd) and linked accordingly.
+class COSMOfileContent {
+
+    memoryMappedFile file;
+    std::vector<char> decompressedText;
+    bool isCompressed = false;
+
+    static bool hasMagicBytes(const memoryMappedFile& file, const unsigned char* magicBytes, size_t numberOfMagicBytes) {
+        return size_t(file.end() - file.begin()) >= numberOfMagicBytes && memcmp(file.begin(), magicBytes, numberOfMagicBytes) == 0;
+    }
+
+    // the output grows geometrically, the decompressed size is used as initial capacity if it is known
+    static void ensureFreeCapacity(std::vector<char>& output, size_t& outputSize) {
+        if (output.size() - outputSize < (size_t(1) << 16))
+            output.resize(std::max(2 * output.size(), outputSize + (size_t(1) << 18)));
+    }
+
+    void decompressGzip(const std::string& path) {
+#if defined(USE_ZLIB)
+        size_t compressedSize = size_t(file.end() - file.begin());
+
+        // the last four bytes of a gzip member hold the uncompressed size modulo 2^32
+        uint32_t expectedSize = 0;
+        if (compressedSize >= 18)
+            memcpy(&expectedSize, file.end() - 4, 4);
+        decompressedText.resize(std::max(size_t(expectedSize) + 1, size_t(1) << 18));
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        // 15 + 16: maximum window size and gzip header
+        if (inflateInit2(&stream, 15 + 16) != Z_OK)
+            throw std::runtime_error("The decompression of the following COSMOfile could not be started: " + path);
+
+        const unsigned char* input = (const unsigned char*)file.begin();
+        size_t remainingInput = compressedSize;
+        size_t outputSize = 0;
+        int status = Z_OK;
+
+        while (remainingInput > 0) {
+            ensureFreeCapacity(decompressedText, outputSize);
+
+            // zlib counts with 32 bit integers, the input is passed in chunks
+            unsigned int inputChunkSize = (unsigned int)std::min(remainingInput, size_t(1) << 30);
+            unsigned int outputChunkSize = (unsigned int)std::min(decompressedText.size() - outputSize, size_t(1) << 30);
+            stream.next_in = (Bytef*)input;
+            stream.avail_in = inputChunkSize;
+            stream.next_out = (Bytef*)(decompressedText.data() + outputSize);
+            stream.avail_out = outputChunkSize;
+
+            status = inflate(&stream, Z_NO_FLUSH);
+
+            input += inputChunkSize - stream.avail_in;
+            remainingInput -= inputChunkSize - stream.avail_in;
+            outputSize += outputChunkSize - stream.avail_out;
+
+            if (status == Z_STREAM_END) {
+                // files may consist of several concatenated gzip members
+                if (remainingInput > 0 && inflateReset(&stream) == Z_OK)
+                    continue;
+                break;
+            }
+            if (status != Z_OK && status != Z_BUF_ERROR)
+                break;
+            if (status == Z_BUF_ERROR && stream.avail_out != 0)
+                break;
+        }
+        inflateEnd(&stream);
+
+        if (status != Z_STREAM_END)
+            throw std::runtime_error("The following gzip compressed COSMOfile could not be decompressed: " + path);
+
+        decompressedText.resize(outputSize);
+#else
+        throw std::runtime_error("The following COSMOfile is gzip compressed, but the code was compiled without zlib support (USE_ZLIB): " + path);
+#endif
+    }
+
+    void decompressZstd(const std::string& path) {
+#if defined(USE_ZSTD)
+        size_t compressedSize = size_t(file.end() - file.begin());
+
+        unsigned long long frameContentSize = ZSTD_getFrameContentSize(file.begin(), compressedSize);
+        size_t initialCapacity = size_t(1) << 18;
+        if (frameContentSize != ZSTD_CONTENTSIZE_UNKNOWN && frameContentSize != ZSTD_CONTENTSIZE_ERROR)
+            initialCapacity = std::max(initialCapacity, size_t(frameContentSize) + 1);
+        decompressedText.resize(initialCapacity);
+
+        ZSTD_DStream* stream = ZSTD_createDStream();
+        if (stream == nullptr || ZSTD_isError(ZSTD_initDStream(stream))) {
+            ZSTD_freeDStream(stream);
+            throw std::runtime_error("The decompression of the following COSMOfile could not be started: " + path);
+        }
+
+        ZSTD_inBuffer input = { file.begin(), compressedSize, 0 };
+        size_t outputSize = 0;
+        size_t status = 0;
 
-void _parse_line(int numberOfArgumentsToParse, const std::string& haystack, const char* format, ...) {
-    const char* str = haystack.c_str();
-    va_list args;
+        while (input.pos < input.size) {
+            ensureFreeCapacity(decompressedText, outputSize);
 
-    va_start(args, format);
-    int numberOfArgumentsFound = vsscanf(str, format, args);
-    va_end(args);
+            ZSTD_outBuffer output = { decompressedText.data() + outputSize, decompressedText.size() - outputSize, 0 };
+            status = ZSTD_decompressStream(stream, &output, &input);
+            outputSize += output.pos;
+
+            if (ZSTD_isError(status))
+                break;
+        }
+        // data still buffered by the decoder after the input has been consumed
+        while (!ZSTD_isError(status) && status != 0) {
+            ensureFreeCapacity(decompressedText, outputSize);
+
+            ZSTD_outBuffer output = { decompressedText.data() + outputSize, decompressedText.size() - outputSize, 0 };
+            status = ZSTD_decompressStream(stream, &output, &input);
+            outputSize += output.pos;
+
+            if (output.pos == 0)
+                break;
+        }
+        ZSTD_freeDStream(stream);
+
+        // a status of zero marks a completely decoded frame
+        if (ZSTD_isError(status) || status != 0)
+            throw std::runtime_error("The following zstd compressed COSMOfile could not be decompressed: " + path);
+
+        decompressedText.resize(outputSize);
+#else
+        throw std::runtime_error("The following COSMOfile is zstd compressed, but the code was compiled without zstd support (USE_ZSTD): " + path);
+#endif
+    }
+
+public:
+    COSMOfileContent(const std::string& path) : file(path) {
+
+        static const unsigned char gzipMagicBytes[] = { 0x1f, 0x8b };
+        static const unsigned char zstdMagicBytes[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+        if (!file.isOpen())
+            return;
+
+        if (hasMagicBytes(file, gzipMagicBytes, sizeof(gzipMagicBytes))) {
+            isCompressed = true;
+            decompressGzip(path);
+        }
+        else if (hasMagicBytes(file, zstdMagicBytes, sizeof(zstdMagicBytes))) {
+            isCompressed = true;
+            decompressZstd(path);
+        }
+    }
+
+    COSMOfileContent(const COSMOfileContent&) = delete;
+    COSMOfileContent& operator=(const COSMOfileContent&) = delete;
+
+    bool isOpen() const { return file.isOpen(); }
+    const char* begin() const { return isCompressed ? decompressedText.data() : file.begin(); }
+    const char* end() const { return isCompressed ? decompressedText.data() + decompressedText.size() : file.end(); }
+};
+
+static inline bool isWhitespace(char c) {
+    return std::isspace((unsigned char)c) != 0;
+}
+
+// line of a memory mapped file, referencing the mapped memory without copying
+struct textLine {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    textLine trimmed() const {
+        textLine line = *this;
+        while (line.begin < line.end && isWhitespace(*line.begin)) line.begin++;
+        while (line.end > line.begin && isWhitespace(*(line.end - 1))) line.end--;
+        return line;
+    }
+
+    size_t size() const { return size_t(end - begin); }
+    bool empty() const { return begin == end; }
+
+    bool startsWith(const char* needle) const {
+        size_t needleSize = strlen(needle);
+        return needleSize <= size() && memcmp(begin, needle, needleSize) == 0;
+    }
 
-    if (numberOfArgumentsFound != numberOfArgumentsToParse) {
-        throw std::runtime_error("The following line could not be parsed: " + haystack);
+    bool endsWith(const char* needle) const {
+        size_t needleSize = strlen(needle);
+        return needleSize <= size() && memcmp(end - needleSize, needle, needleSize) == 0;
     }
+
+    bool equals(const char* other) const {
+        return strlen(other) == size() && memcmp(begin, other, size()) == 0;
+    }
+
+    std::string str() const { return std::string(begin, end); }
+};
+
+// reads the lines of a memory mapped or decompressed file with the same semantics as std::getline
+class mappedTextReader {
+
+    const char* position;
+    const char* end;
+
+public:
+    mappedTextReader(const memoryMappedFile& file) : position(file.begin()), end(file.end()) {}
+    mappedTextReader(const COSMOfileContent& file) : position(file.begin()), end(file.end()) {}
+
+    bool getline(textLine& line) {
+        if (position >= end)
+            return false;
+
+        const char* lineEnd = (const char*)memchr(position, '\n', size_t(end - position));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+
+        line.begin = position;
+        line.end = lineEnd;
+        position = lineEnd < end ? lineEnd + 1 : end;
+        return true;
+    }
+
+    // returns the first line of which the trimmed version starts or ends with the needle and skips the given number of lines after it
+    textLine scanFor(const char* needle, std::string mode = "start", int numberOfLinesToSkip = 0, bool throwErrorIfNotFound = true) {
+
+        textLine currentLine;
+        textLine matchingLine;
+        bool found = false;
+
+        while (getline(currentLine)) {
+            textLine trimmedLine = currentLine.trimmed();
+
+            if ((mode == "start" && trimmedLine.startsWith(needle)) || (mode == "end" && trimmedLine.endsWith(needle))) {
+                matchingLine = trimmedLine;
+                found = true;
+                break;
+            }
+        }
+
+        for (int i = 0; i < numberOfLinesToSkip; i++)
+            getline(currentLine);
+
+        if (found == false && throwErrorIfNotFound) {
+            throw std::runtime_error("the following string was not found while reading haystack_file: " + std::string(needle));
+        }
+
+        return matchingLine;
+    }
+};
+
+// number scanners for memory mapped text, they skip leading whitespace like scanf and advance the position.
+// Doubles with up to 19 significant digits and a decimal exponent of at most 22 are converted exactly with a single
+// multiplication or division (Clinger's fast path), all other numbers are handed to strtod so that the results are
+// identical to the ones of scanf.
+static bool scanDoubleWithStrtod(const char*& position, const char* end, double& value) {
+
+    char buffer[128];
+    size_t length = 0;
+    while (position + length < end && isWhitespace(position[length]) == false && length < sizeof(buffer) - 1) {
+        buffer[length] = position[length];
+        length++;
+    }
+    buffer[length] = '\0';
+
+    char* parsedEnd;
+    value = strtod(buffer, &parsedEnd);
+    if (parsedEnd == buffer)
+        return false;
+
+    position += parsedEnd - buffer;
+    return true;
+}
+
+static bool scanDouble(const char*& position, const char* end, double& value) {
+
+    static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    while (position < end && isWhitespace(*position)) position++;
+
+    const char* current = position;
+    bool negative = false;
+    if (current < end && (*current == '-' || *current == '+')) {
+        negative = *current == '-';
+        current++;
+    }
+
+    uint64_t mantissa = 0;
+    int numberOfSignificantDigits = 0;
+    int numberOfDigits = 0;
+    int decimalExponent = 0;
+
+    for (; current < end && *current >= '0' && *current <= '9'; current++, numberOfDigits++) {
+        if (mantissa != 0 || *current != '0') {
+            mantissa = 10 * mantissa + uint64_t(*current - '0');
+            numberOfSignificantDigits++;
+        }
+    }
+
+    if (current < end && *current == '.') {
+        current++;
+        for (; current < end && *current >= '0' && *current <= '9'; current++, numberOfDigits++) {
+            if (mantissa != 0 || *current != '0') {
+                mantissa = 10 * mantissa + uint64_t(*current - '0');
+                numberOfSignificantDigits++;
+            }
+            decimalExponent--;
+        }
+    }
+
+    if (numberOfDigits == 0)
+        return scanDoubleWithStrtod(position, end, value);
+
+    if (current < end && (*current == 'e' || *current == 'E')) {
+        const char* exponentStart = current + 1;
+        bool negativeExponent = false;
+        if (exponentStart < end && (*exponentStart == '-' || *exponentStart == '+')) {
+            negativeExponent = *exponentStart == '-';
+            exponentStart++;
+        }
+        if (exponentStart < end && *exponentStart >= '0' && *exponentStart <= '9') {
+            int exponent = 0;
+            for (current = exponentStart; current < end && *current >= '0' && *current <= '9'; current++) {
+                if (exponent < 10000)
+                    exponent = 10 * exponent + (*current - '0');
+            }
+            decimalExponent += negativeExponent ? -exponent : exponent;
+        }
+    }
+
+    // anything unusual directly after the number is left to strtod
+    if (current < end && isWhitespace(*current) == false)
+        return scanDoubleWithStrtod(position, end, value);
+
+    if (mantissa == 0) {
+        value = negative ? -0.0 : 0.0;
+    }
+    else if (numberOfSignificantDigits <= 19 && mantissa <= (uint64_t(1) << 53) && decimalExponent >= -22 && decimalExponent <= 22) {
+        value = decimalExponent < 0 ? double(mantissa) / powersOfTen[-decimalExponent] : double(mantissa) * powersOfTen[decimalExponent];
+        if (negative)
+            value = -value;
+    }
+    else {
+        return scanDoubleWithStrtod(position, end, value);
+    }
+
+    position = current;
+    return true;
+}
+
+static bool scanFloat(const char*& position, const char* end, float& value) {
+
+    while (position < end && isWhitespace(*position)) position++;
+
+    char buffer[128];
+    size_t length = 0;
+    while (position + length < end && isWhitespace(position[length]) == false && length < sizeof(buffer) - 1) {
+        buffer[length] = position[length];
+        length++;
+    }
+    buffer[length] = '\0';
+
+    char* parsedEnd;
+    value = strtof(buffer, &parsedEnd);
+    if (parsedEnd == buffer)
+        return false;
+
+    position += parsedEnd - buffer;
+    return true;
+}
+
+static bool scanInteger(const char*& position, const char* end, int& value) {
+
+    while (position < end && isWhitespace(*position)) position++;
+
+    const char* current = position;
+    bool negative = false;
+    if (current < end && (*current == '-' || *current == '+')) {
+        negative = *current == '-';
+        current++;
+    }
+
+    if (current == end || *current < '0' || *current > '9')
+        return false;
+
+    long long result = 0;
+    for (; current < end && *current >= '0' && *current <= '9'; current++) {
+        result = 10 * result + (*current - '0');
+        if (result > INT32_MAX)
+            return false;
+    }
+
+    value = int(negative ? -result : result);
+    position = current;
+    return true;
+}
+
+// reads a word of at most maximumLength characters like %<maximumLength>s
+static bool scanWord(const char*& position, const char* end, size_t maximumLength, std::string& word) {
+
+    while (position < end && isWhitespace(*position)) position++;
+
+    const char* current = position;
+    while (current < end && isWhitespace(*current) == false && size_t(current - position) < maximumLength) current++;
+
+    if (current == position)
+        return false;
+
+    word.assign(position, current);
+    position = current;
+    return true;
+}
+
+static void throwParseError(const textLine& line) {
+    throw std::runtime_error("The following line could not be parsed: " + line.str());
 }
 
 std::string periodicTableElements[118] = { "H", "He", "Li", "Be", "B", "C", "N", "O", "F", "Ne", "Na", "Mg", "Al", "Si", "P", "S", "Cl", "Ar", \
@@ -45,341 +545,471 @@ int findAtomicNumberByName(std::string& name) {
     throw std::runtime_error("Could not find the atomic number for followng atom: " + name);
 }
 
-std::string scan_for(std::ifstream& haystack_file, std::string needle, std::string mode = "start", int numberOfLinesToSkip = 0, bool throwErrorIfNotFound = true) {
-    
-    std::string currentLine;
-    std::string matchingLine = "";
 
-    while (std::getline(haystack_file, currentLine))
-    {
-        currentLine = trim(currentLine);
+// the atom name of a line is read like %3s and converted to the atomic number
+static int scanAtomicNumber(const char*& position, const char* end, const textLine& line) {
 
-        if (mode == "start")
-            if (startsWith(currentLine, needle)) {
-                matchingLine = currentLine;
-                break;
-            }
+    std::string atomName;
+    if (!scanWord(position, end, 3, atomName))
+        throwParseError(line);
 
-        if (mode == "end")
-            if (endsWith(currentLine, needle)) {
-                matchingLine = currentLine;
-                break;
-            }
-    }
+    atomName[0] = toupper(atomName[0]);
+    atomName = trim(atomName);
 
-    for (int i = 0; i < numberOfLinesToSkip; i++)
-        std::getline(haystack_file, currentLine);
+    return findAtomicNumberByName(atomName);
+}
 
-    if (matchingLine != "")
-        return matchingLine;
+// parses the number after the first "=" of a line
+static double scanValueAfterEqualSign(const textLine& line) {
 
-    if (throwErrorIfNotFound) {
-        throw std::runtime_error("the following string was not found while reading haystack_file: " + needle);
-    }
-    else {
-        return "";
-    }
+    const char* position = (const char*)memchr(line.begin, '=', line.size());
+    double value;
+    if (position == nullptr || !scanDouble(++position, line.end, value))
+        throwParseError(line);
+
+    return value;
 }
 
 molecule getMoleculeFromTurbomoleCOSMOfile(std::string& path) {
 
-    std::ifstream cosmoFile(path);
+    COSMOfileContent cosmoFile(path);
 
-    if (cosmoFile.fail()) {
+    if (!cosmoFile.isOpen()) {
         throw std::runtime_error("The following COSMOfile could not be opened: " + path);
     }
 
-    std::string currentLine;
-    std::string lastLine;
+    mappedTextReader reader(cosmoFile);
+
+    textLine currentLine;
+    textLine lastLine;
 
     int section = 1;
 
-    std::vector<double> atomPositions_X;
-    std::vector<double> atomPositions_Y;
-    std::vector<double> atomPositions_Z;
-    std::vector<double> atomRadii;
-    std::vector<int> atomAtomicNumbers;
+    molecule newMolecule;
 
-    std::vector<double> segmentPositions_X;
-    std::vector<double> segmentPositions_Y;
-    std::vector<double> segmentPositions_Z;
-    std::vector<int> segmentAtomIndices;
-    std::vector<double> segmentAreas;
-    std::vector<double> segmentSigmas;
+    reader.getline(currentLine);
+    reader.getline(currentLine);
+    newMolecule.qmMethod = replace(currentLine.trimmed().str(), "prog.: ", "");
 
-    molecule newMolecule;
+    // the number of atoms and segments is not known in advance, the values are written into Eigen storage growing geometrically
+    int numberOfAtoms = 0;
+    int numberOfSegments = 0;
+
+    auto ensureCapacity = [](auto& storage, int numberOfRows) {
+        if (numberOfRows > storage.rows())
+            storage.conservativeResize(std::max(2 * int(storage.rows()), std::max(numberOfRows, 64)), Eigen::NoChange);
+    };
 
-    std::getline(cosmoFile, currentLine);
-    std::getline(cosmoFile, currentLine);
-    newMolecule.qmMethod = replace(trim(currentLine), "prog.: ", "");
+    newMolecule.atomPositions.resize(0, 3);
+    newMolecule.atomRadii.resize(0);
+    newMolecule.atomAtomicNumbers.resize(0);
+    newMolecule.segmentPositions.resize(0, 3);
+    newMolecule.segmentAtomIndices.resize(0);
+    newMolecule.segmentAreas.resize(0);
+    newMolecule.segmentSigmas.resize(0);
 
-    while (std::getline(cosmoFile, currentLine))
+    while (reader.getline(currentLine))
     {
-        currentLine = trim(currentLine);
+        currentLine = currentLine.trimmed();
 
-        if (startsWith(lastLine, "#atom")) {
+        if (lastLine.startsWith("#atom")) {
             section = 2;
         }
 
-        if (startsWith(currentLine, "$coord_car")) {
+        if (currentLine.startsWith("$coord_car")) {
             section = 3;
         }
 
-        if (startsWith(lastLine, "#  n   atom ")) {
+        if (lastLine.startsWith("#  n   atom ")) {
             section = 4;
-            std::getline(cosmoFile, currentLine);
-            std::getline(cosmoFile, currentLine);
+            reader.getline(currentLine);
+            reader.getline(currentLine);
         }
 
         if (section == 1) {
 
-            if (startsWith(currentLine, "area")) {
-                currentLine = replace(trim(currentLine), " ", "");
-                parse_line(currentLine, " %*[^=]=%lf", &(newMolecule.Area));
-                newMolecule.Area = pow(0.529177249, 2) * newMolecule.Area;
+            if (currentLine.startsWith("area")) {
+                newMolecule.Area = pow(0.529177249, 2) * scanValueAfterEqualSign(currentLine);
             }
 
-            if (startsWith(currentLine, "volume")) {
-                currentLine = replace(trim(currentLine), " ", "");
-                parse_line(currentLine, " %*[^=]=%lf", &(newMolecule.Volume));
-                newMolecule.Volume = pow(0.529177249, 3) * newMolecule.Volume;
+            if (currentLine.startsWith("volume")) {
+                newMolecule.Volume = pow(0.529177249, 3) * scanValueAfterEqualSign(currentLine);
             }
 
-            if (startsWith(currentLine, "Total energy + OC corr.")) {
-                currentLine = replace(trim(currentLine), " ", "");
-                parse_line(currentLine, " %*[^=]=%lf", &(newMolecule.epsilonInfinityTotalEnergy));
+            if (currentLine.startsWith("Total energy + OC corr.")) {
+                newMolecule.epsilonInfinityTotalEnergy = scanValueAfterEqualSign(currentLine);
             }
         }
 
         if (section == 2) {
+            const char* position = currentLine.begin;
+            int atomIndex;
             double atomPosition_X, atomPosition_Y, atomPosition_Z, atomRadius;
-            char temp_atomName[3];
-            parse_line(currentLine, "%*i %lf %lf %lf %3s %lf", &atomPosition_X, &atomPosition_Y, &atomPosition_Z, &temp_atomName, &atomRadius);
-            atomPositions_X.push_back(0.529177249 * atomPosition_X);
-            atomPositions_Y.push_back(0.529177249 * atomPosition_Y);
-            atomPositions_Z.push_back(0.529177249 * atomPosition_Z);
 
-            temp_atomName[0] = toupper(temp_atomName[0]);
-            std::string atomName(temp_atomName);
-            atomName = trim(atomName);
+            if (!scanInteger(position, currentLine.end, atomIndex) || !scanDouble(position, currentLine.end, atomPosition_X) ||
+                !scanDouble(position, currentLine.end, atomPosition_Y) || !scanDouble(position, currentLine.end, atomPosition_Z)) {
+                throwParseError(currentLine);
+            }
+            int atomicNumber = scanAtomicNumber(position, currentLine.end, currentLine);
+            if (!scanDouble(position, currentLine.end, atomRadius)) {
+                throwParseError(currentLine);
+            }
 
-            atomAtomicNumbers.push_back(findAtomicNumberByName(atomName));
+            ensureCapacity(newMolecule.atomPositions, numberOfAtoms + 1);
+            ensureCapacity(newMolecule.atomRadii, numberOfAtoms + 1);
+            ensureCapacity(newMolecule.atomAtomicNumbers, numberOfAtoms + 1);
 
-            atomRadii.push_back(atomRadius);
+            newMolecule.atomPositions(numberOfAtoms, 0) = 0.529177249 * atomPosition_X;
+            newMolecule.atomPositions(numberOfAtoms, 1) = 0.529177249 * atomPosition_Y;
+            newMolecule.atomPositions(numberOfAtoms, 2) = 0.529177249 * atomPosition_Z;
+            newMolecule.atomAtomicNumbers(numberOfAtoms) = atomicNumber;
+            newMolecule.atomRadii(numberOfAtoms) = atomRadius;
+            numberOfAtoms++;
         }
 
         if (section == 4) {
-            int segmentAtomIndex;
-            double segmentPosition_X, segmentPosition_Y, segmentPosition_Z, segmentArea, segmentSigma;
-            parse_line(currentLine, "%*i %i %lf %lf %lf %*lf %lf %lf", &segmentAtomIndex, &segmentPosition_X, &segmentPosition_Y, &segmentPosition_Z, &segmentArea, &segmentSigma);
-            segmentAtomIndices.push_back(segmentAtomIndex - 1);
-
-            segmentPositions_X.push_back(0.529177249 * segmentPosition_X);
-            segmentPositions_Y.push_back(0.529177249 * segmentPosition_Y);
-            segmentPositions_Z.push_back(0.529177249 * segmentPosition_Z);
-
-            segmentAreas.push_back(segmentArea);
+            const char* position = currentLine.begin;
+            int segmentIndex, segmentAtomIndex;
+            double segmentPosition_X, segmentPosition_Y, segmentPosition_Z, segmentCharge, segmentArea, segmentSigma;
+
+            if (!scanInteger(position, currentLine.end, segmentIndex) || !scanInteger(position, currentLine.end, segmentAtomIndex) ||
+                !scanDouble(position, currentLine.end, segmentPosition_X) || !scanDouble(position, currentLine.end, segmentPosition_Y) ||
+                !scanDouble(position, currentLine.end, segmentPosition_Z) || !scanDouble(position, currentLine.end, segmentCharge) ||
+                !scanDouble(position, currentLine.end, segmentArea) || !scanDouble(position, currentLine.end, segmentSigma)) {
+                throwParseError(currentLine);
+            }
 
-            segmentSigmas.push_back(segmentSigma);
+            ensureCapacity(newMolecule.segmentPositions, numberOfSegments + 1);
+            ensureCapacity(newMolecule.segmentAtomIndices, numberOfSegments + 1);
+            ensureCapacity(newMolecule.segmentAreas, numberOfSegments + 1);
+            ensureCapacity(newMolecule.segmentSigmas, numberOfSegments + 1);
+
+            newMolecule.segmentAtomIndices(numberOfSegments) = segmentAtomIndex - 1;
+            newMolecule.segmentPositions(numberOfSegments, 0) = 0.529177249 * segmentPosition_X;
+            newMolecule.segmentPositions(numberOfSegments, 1) = 0.529177249 * segmentPosition_Y;
+            newMolecule.segmentPositions(numberOfSegments, 2) = 0.529177249 * segmentPosition_Z;
+            newMolecule.segmentAreas(numberOfSegments) = segmentArea;
+            newMolecule.segmentSigmas(numberOfSegments) = segmentSigma;
+            numberOfSegments++;
         }
 
         lastLine = currentLine;
     }
-    cosmoFile.close();
 
-    newMolecule.atomPositions = Eigen::MatrixXd::Zero(atomPositions_X.size(), 3);
-
-    for (int i = 0; i < atomPositions_X.size(); i++) {
-        newMolecule.atomPositions(i, 0) = atomPositions_X[i];
-        newMolecule.atomPositions(i, 1) = atomPositions_Y[i];
-        newMolecule.atomPositions(i, 2) = atomPositions_Z[i];
-    }
-    newMolecule.atomAtomicNumbers = Eigen::Map<Eigen::VectorXi>(atomAtomicNumbers.data(), atomAtomicNumbers.size());
-    newMolecule.atomRadii = Eigen::Map<Eigen::VectorXd>(atomRadii.data(), int(atomRadii.size()));
-
-    newMolecule.segmentPositions = Eigen::MatrixXd::Zero(segmentPositions_X.size(), 3);
-
-    for (int i = 0; i < segmentPositions_X.size(); i++) {
-        newMolecule.segmentPositions(i, 0) = segmentPositions_X[i];
-        newMolecule.segmentPositions(i, 1) = segmentPositions_Y[i];
-        newMolecule.segmentPositions(i, 2) = segmentPositions_Z[i];
-    }
-
-    newMolecule.segmentAtomIndices = Eigen::Map<Eigen::VectorXi>(segmentAtomIndices.data(), segmentAtomIndices.size());
-    newMolecule.segmentAreas = Eigen::Map<Eigen::VectorXd>(segmentAreas.data(), segmentAreas.size());
-    newMolecule.segmentSigmas = Eigen::Map<Eigen::VectorXd>(segmentSigmas.data(), segmentSigmas.size());
+    newMolecule.atomPositions.conservativeResize(numberOfAtoms, Eigen::NoChange);
+    newMolecule.atomRadii.conservativeResize(numberOfAtoms);
+    newMolecule.atomAtomicNumbers.conservativeResize(numberOfAtoms);
+    newMolecule.segmentPositions.conservativeResize(numberOfSegments, Eigen::NoChange);
+    newMolecule.segmentAtomIndices.conservativeResize(numberOfSegments);
+    newMolecule.segmentAreas.conservativeResize(numberOfSegments);
+    newMolecule.segmentSigmas.conservativeResize(numberOfSegments);
 
     return newMolecule;
 }
 
 molecule getMoleculeFromORCACOSMOfile(std::string& path) {
 
-    std::ifstream cosmoFile(path);
+    COSMOfileContent cosmoFile(path);
 
-    if (cosmoFile.fail()) {
+    if (!cosmoFile.isOpen()) {
         throw std::runtime_error("The following COSMOfile could not be opened: " + path);
     }
 
-    std::string currentLine;
-    std::string lastLine;
-
-    std::vector<double> atomPositions_X;
-    std::vector<double> atomPositions_Y;
-    std::vector<double> atomPositions_Z;
-    std::vector<double> atomRadii;
-    std::vector<int> atomAtomicNumbers;
+    mappedTextReader reader(cosmoFile);
 
-    std::vector<double> segmentPositions_X;
-    std::vector<double> segmentPositions_Y;
-    std::vector<double> segmentPositions_Z;
-    std::vector<int> segmentAtomIndices;
-    std::vector<double> segmentAreas;
-    std::vector<double> segmentSigmas;
+    textLine currentLine;
 
     molecule newMolecule;
 
-    std::getline(cosmoFile, currentLine);
+    reader.getline(currentLine);
 
-    std::vector<std::string> parts = split(currentLine, ':');
+    std::vector<std::string> parts = split(currentLine.str(), ':');
     newMolecule.qmMethod = replace(trim(parts[1]), "COSMO", "CPCM");
     newMolecule.name = trim(parts[0]);
 
-    scan_for(cosmoFile, "#ENERGY");
-    std::getline(cosmoFile, currentLine);
-    currentLine = trim(replace(currentLine, "FINAL SINGLE POINT ENERGY", ""));
-    newMolecule.epsilonInfinityTotalEnergy = std::stod(currentLine);
+    reader.scanFor("#ENERGY");
+    reader.getline(currentLine);
+    newMolecule.epsilonInfinityTotalEnergy = std::stod(trim(replace(currentLine.str(), "FINAL SINGLE POINT ENERGY", "")));
 
-    scan_for(cosmoFile, "#XYZ_FILE");
+    reader.scanFor("#XYZ_FILE");
 
     int numberOfAtoms;
-    std::getline(cosmoFile, currentLine);
-    parse_line(currentLine, "%i", &numberOfAtoms);
-    std::getline(cosmoFile, currentLine);
+    reader.getline(currentLine);
+    {
+        const char* position = currentLine.begin;
+        if (!scanInteger(position, currentLine.end, numberOfAtoms))
+            throwParseError(currentLine);
+    }
+    reader.getline(currentLine);
 
-    for (int i = 0; i < numberOfAtoms; i++) {
+    newMolecule.atomPositions.resize(numberOfAtoms, 3);
+    newMolecule.atomAtomicNumbers.resize(numberOfAtoms);
+    newMolecule.atomRadii.resize(numberOfAtoms);
 
-        std::getline(cosmoFile, currentLine);
+    for (int i = 0; i < numberOfAtoms; i++) {
 
-        double atomPosition_X, atomPosition_Y, atomPosition_Z;
-        char temp_atomName[3];
-        parse_line(currentLine, "%3s %lf %lf %lf", &temp_atomName , &atomPosition_X, &atomPosition_Y, &atomPosition_Z);
-        atomPositions_X.push_back(atomPosition_X);
-        atomPositions_Y.push_back(atomPosition_Y);
-        atomPositions_Z.push_back(atomPosition_Z);
+        if (!reader.getline(currentLine))
+            throwParseError(textLine());
 
-        temp_atomName[0] = toupper(temp_atomName[0]);
-        std::string atomName(temp_atomName);
-        atomName = trim(atomName);
+        const char* position = currentLine.begin;
+        newMolecule.atomAtomicNumbers(i) = scanAtomicNumber(position, currentLine.end, currentLine);
 
-        atomAtomicNumbers.push_back(findAtomicNumberByName(atomName));
+        for (int d = 0; d < 3; d++) {
+            if (!scanDouble(position, currentLine.end, newMolecule.atomPositions(i, d)))
+                throwParseError(currentLine);
+        }
     }
-    newMolecule.atomAtomicNumbers = Eigen::Map<Eigen::VectorXi>(atomAtomicNumbers.data(), atomAtomicNumbers.size());
 
-    currentLine = scan_for(cosmoFile, "# Volume", "end");
-    parse_line(currentLine, " %lf", &(newMolecule.Volume));
+    currentLine = reader.scanFor("# Volume", "end");
+    {
+        const char* position = currentLine.begin;
+        if (!scanDouble(position, currentLine.end, newMolecule.Volume))
+            throwParseError(currentLine);
+    }
     newMolecule.Volume = pow(0.529177249, 3) * newMolecule.Volume;
 
-    currentLine = scan_for(cosmoFile, "# Area", "end");
-    parse_line(currentLine, " %lf", &(newMolecule.Area));
+    currentLine = reader.scanFor("# Area", "end");
+    {
+        const char* position = currentLine.begin;
+        if (!scanDouble(position, currentLine.end, newMolecule.Area))
+            throwParseError(currentLine);
+    }
     newMolecule.Area = pow(0.529177249, 2) * newMolecule.Area;
 
-    currentLine = scan_for(cosmoFile, "# CPCM dielectric energy", "end");
+    currentLine = reader.scanFor("# CPCM dielectric energy", "end");
     float uncorrectedDialectricEnergy = 0.0;
-    parse_line(currentLine, "%f", &uncorrectedDialectricEnergy);
+    {
+        const char* position = currentLine.begin;
+        if (!scanFloat(position, currentLine.end, uncorrectedDialectricEnergy))
+            throwParseError(currentLine);
+    }
 
-    scan_for(cosmoFile, "# CARTESIAN COORDINATES (A.U.) + RADII (A.U.)", "start", 1);
+    reader.scanFor("# CARTESIAN COORDINATES (A.U.) + RADII (A.U.)", "start", 1);
     for (int i = 0; i < numberOfAtoms; i++) {
-        std::getline(cosmoFile, currentLine);
-        double atomRadius;
-        parse_line(currentLine, "%*lf %*lf %*lf %lf", &atomRadius);
-        atomRadii.push_back(atomRadius * 0.529177249);
+        reader.getline(currentLine);
+        const char* position = currentLine.begin;
+        double value, atomRadius;
+        if (!scanDouble(position, currentLine.end, value) || !scanDouble(position, currentLine.end, value) ||
+            !scanDouble(position, currentLine.end, value) || !scanDouble(position, currentLine.end, atomRadius)) {
+            throwParseError(currentLine);
+        }
+        newMolecule.atomRadii(i) = atomRadius * 0.529177249;
     }
-    newMolecule.atomRadii = Eigen::Map<Eigen::VectorXd>(atomRadii.data(), int(atomRadii.size()));
 
-    scan_for(cosmoFile, "# SURFACE POINTS (A.U.)", "start", 2);
-    while (std::getline(cosmoFile, currentLine)) {
+    // the segments are written directly into Eigen storage growing geometrically
+    int numberOfSegments = 0;
+    auto ensureCapacity = [](auto& storage, int numberOfRows) {
+        if (numberOfRows > storage.rows())
+            storage.conservativeResize(std::max(2 * int(storage.rows()), std::max(numberOfRows, 256)), Eigen::NoChange);
+    };
+
+    newMolecule.segmentPositions.resize(0, 3);
+    newMolecule.segmentAtomIndices.resize(0);
+    newMolecule.segmentAreas.resize(0);
+    newMolecule.segmentSigmas.resize(0);
+
+    reader.scanFor("# SURFACE POINTS (A.U.)", "start", 2);
+    while (reader.getline(currentLine)) {
 
-        currentLine = trim(currentLine);
+        currentLine = currentLine.trimmed();
 
-        if (currentLine != "") {
+        if (!currentLine.empty()) {
 
+            const char* position = currentLine.begin;
             int segmentAtomIndex;
-            double segmentPosition_X, segmentPosition_Y, segmentPosition_Z, segmentArea, segmentCharge;
-            parse_line(currentLine, "%lf %lf %lf %lf %*lf %lf %*lf %*lf %*lf %i", &segmentPosition_X, &segmentPosition_Y, &segmentPosition_Z, &segmentArea, &segmentCharge, &segmentAtomIndex);
-            segmentAtomIndices.push_back(segmentAtomIndex);
+            double segmentPosition_X, segmentPosition_Y, segmentPosition_Z, segmentArea, segmentCharge, value;
+            if (!scanDouble(position, currentLine.end, segmentPosition_X) || !scanDouble(position, currentLine.end, segmentPosition_Y) ||
+                !scanDouble(position, currentLine.end, segmentPosition_Z) || !scanDouble(position, currentLine.end, segmentArea) ||
+                !scanDouble(position, currentLine.end, value) || !scanDouble(position, currentLine.end, segmentCharge) ||
+                !scanDouble(position, currentLine.end, value) || !scanDouble(position, currentLine.end, value) ||
+                !scanDouble(position, currentLine.end, value) || !scanInteger(position, currentLine.end, segmentAtomIndex)) {
+                throwParseError(currentLine);
+            }
+
+            ensureCapacity(newMolecule.segmentPositions, numberOfSegments + 1);
+            ensureCapacity(newMolecule.segmentAtomIndices, numberOfSegments + 1);
+            ensureCapacity(newMolecule.segmentAreas, numberOfSegments + 1);
+            ensureCapacity(newMolecule.segmentSigmas, numberOfSegments + 1);
 
-            segmentPositions_X.push_back(0.529177249 * segmentPosition_X);
-            segmentPositions_Y.push_back(0.529177249 * segmentPosition_Y);
-            segmentPositions_Z.push_back(0.529177249 * segmentPosition_Z);
+            newMolecule.segmentAtomIndices(numberOfSegments) = segmentAtomIndex;
+
+            newMolecule.segmentPositions(numberOfSegments, 0) = 0.529177249 * segmentPosition_X;
+            newMolecule.segmentPositions(numberOfSegments, 1) = 0.529177249 * segmentPosition_Y;
+            newMolecule.segmentPositions(numberOfSegments, 2) = 0.529177249 * segmentPosition_Z;
 
             segmentArea = 0.529177249 * 0.529177249 * segmentArea;
-            segmentAreas.push_back(segmentArea);
+            newMolecule.segmentAreas(numberOfSegments) = segmentArea;
 
-            segmentSigmas.push_back(segmentCharge / segmentArea);
+            newMolecule.segmentSigmas(numberOfSegments) = segmentCharge / segmentArea;
+            numberOfSegments++;
         }
         else {
             break;
         }
     }
 
-    std::string matchingLine = scan_for(cosmoFile, "#COSMO_corrected", "start", 0, false);
-    if (matchingLine != "") {
-        std::getline(cosmoFile, currentLine);
-        if (!startsWith(currentLine, "Corrected dielectric energy   =")) {
+    newMolecule.segmentPositions.conservativeResize(numberOfSegments, Eigen::NoChange);
+    newMolecule.segmentAtomIndices.conservativeResize(numberOfSegments);
+    newMolecule.segmentAreas.conservativeResize(numberOfSegments);
+    newMolecule.segmentSigmas.conservativeResize(numberOfSegments);
+
+    textLine matchingLine = reader.scanFor("#COSMO_corrected", "start", 0, false);
+    if (!matchingLine.empty()) {
+        reader.getline(currentLine);
+        if (!currentLine.startsWith("Corrected dielectric energy   =")) {
             throw std::runtime_error("Could not find the corrected dielectric energy entry in the orcacosmo file.");
         }
-        currentLine = trim(replace(currentLine, "Corrected dielectric energy   =", ""));
         float correctedDielectricEnergy = 0.0;
-        parse_line(currentLine, "%f", &correctedDielectricEnergy);
+        {
+            const char* position = currentLine.begin + strlen("Corrected dielectric energy   =");
+            if (!scanFloat(position, currentLine.end, correctedDielectricEnergy))
+                throwParseError(currentLine);
+        }
         newMolecule.epsilonInfinityTotalEnergy = newMolecule.epsilonInfinityTotalEnergy - uncorrectedDialectricEnergy + correctedDielectricEnergy;
 
-        std::getline(cosmoFile, currentLine);
-        std::getline(cosmoFile, currentLine);
+        reader.getline(currentLine);
+        reader.getline(currentLine);
 
         int segmentIndex = 0;
-        while (std::getline(cosmoFile, currentLine)) {
+        while (reader.getline(currentLine)) {
 
-            currentLine = trim(currentLine);
+            currentLine = currentLine.trimmed();
 
-            if (currentLine == "##################################################")
+            if (currentLine.equals("##################################################"))
                 break;
 
-            if (currentLine != "") {
+            if (!currentLine.empty()) {
 
+                const char* position = currentLine.begin;
                 double correctedSegmentCharge;
-                parse_line(currentLine, "%lf", &correctedSegmentCharge);
+                if (!scanDouble(position, currentLine.end, correctedSegmentCharge))
+                    throwParseError(currentLine);
 
-                segmentSigmas[segmentIndex] = correctedSegmentCharge / segmentAreas[segmentIndex];
+                if (segmentIndex < numberOfSegments)
+                    newMolecule.segmentSigmas(segmentIndex) = correctedSegmentCharge / newMolecule.segmentAreas(segmentIndex);
                 segmentIndex += 1;
             }
         }
 
-        if (segmentIndex != segmentSigmas.size()) {
+        if (segmentIndex != numberOfSegments) {
             throw std::runtime_error("Not enough corrected charges where found parsing the following file: " + path);
         }
     }
-    cosmoFile.close();
 
-    newMolecule.atomPositions = Eigen::MatrixXd::Zero(atomPositions_X.size(), 3);
+    return newMolecule;
+}
 
-    for (int i = 0; i < atomPositions_X.size(); i++) {
-        newMolecule.atomPositions(i, 0) = atomPositions_X[i];
-        newMolecule.atomPositions(i, 1) = atomPositions_Y[i];
-        newMolecule.atomPositions(i, 2) = atomPositions_Z[i];
+// reads an extended sigma profile written by WriteExtendedSigmaProfiletoFile, the segment types are used as they are
+// and the hash of the settings they were calculated with is returned to be compared with the current settings
+molecule getMoleculeFromExtendedSigmaProfile(std::string& path, uint64_t& settingsHash) {
+
+    COSMOfileContent profileFile(path);
+
+    if (!profileFile.isOpen()) {
+        throw std::runtime_error("The following extended sigma profile could not be opened: " + path);
     }
-    newMolecule.atomAtomicNumbers = Eigen::Map<Eigen::VectorXi>(atomAtomicNumbers.data(), atomAtomicNumbers.size());
-    newMolecule.atomRadii = Eigen::Map<Eigen::VectorXd>(atomRadii.data(), int(atomRadii.size()));
 
-    newMolecule.segmentPositions = Eigen::MatrixXd::Zero(segmentPositions_X.size(), 3);
-    for (int i = 0; i < segmentPositions_X.size(); i++) {
-        newMolecule.segmentPositions(i, 0) = segmentPositions_X[i];
-        newMolecule.segmentPositions(i, 1) = segmentPositions_Y[i];
-        newMolecule.segmentPositions(i, 2) = segmentPositions_Z[i];
+    mappedTextReader reader(profileFile);
+
+    textLine currentLine;
+
+    molecule newMolecule;
+    segmentTypeCollection& segments = newMolecule.segments;
+
+    bool settingsFound = false;
+    std::vector<int> atomicNumbers;
+    std::vector<std::string> foundKeys;
+
+    while (reader.getline(currentLine)) {
+
+        currentLine = currentLine.trimmed();
+
+        if (currentLine.empty())
+            continue;
+
+        if (currentLine.startsWith("#")) {
+            const char* separator = (const char*)memchr(currentLine.begin, ':', currentLine.size());
+            if (separator == nullptr)
+                continue;
+
+            std::string key = trim(std::string(currentLine.begin + 1, separator));
+            textLine value = textLine{ separator + 1, currentLine.end }.trimmed();
+            const char* position = value.begin;
+            foundKeys.push_back(key);
+
+            if (key == "name") {
+                newMolecule.name = value.str();
+            }
+            else if (key == "qmMethod") {
+                newMolecule.qmMethod = value.str();
+            }
+            else if (key == "settings") {
+                char* parsedEnd;
+                std::string settings = value.str();
+                settingsHash = strtoull(settings.c_str(), &parsedEnd, 16);
+                if (settings.empty() || *parsedEnd != '\0')
+                    throwParseError(currentLine);
+                settingsFound = true;
+            }
+            else if (key == "Area" || key == "Volume" || key == "epsilonInfinityTotalEnergy" || key == "molarVolumeAt25C") {
+                double number;
+                if (!scanDouble(position, value.end, number))
+                    throwParseError(currentLine);
+
+                if (key == "Area") newMolecule.Area = number;
+                else if (key == "Volume") newMolecule.Volume = number;
+                else if (key == "epsilonInfinityTotalEnergy") newMolecule.epsilonInfinityTotalEnergy = number;
+                else newMolecule.molarVolumeAt25C = number;
+            }
+            else if (key == "moleculeCharge" || key == "moleculeGroup") {
+                int number;
+                if (!scanInteger(position, value.end, number))
+                    throwParseError(currentLine);
+
+                if (key == "moleculeCharge") newMolecule.moleculeCharge = (signed char)number;
+                else newMolecule.moleculeGroup = (unsigned short)number;
+            }
+            else if (key == "atomicNumbers") {
+                int atomicNumber;
+                while (scanInteger(position, value.end, atomicNumber))
+                    atomicNumbers.push_back(atomicNumber);
+            }
+            continue;
+        }
+
+        const char* position = currentLine.begin;
+        int segmentTypeIndex, atomicNumber, HBtype, group;
+        float sigma, sigmaCorr;
+        double area;
+
+        if (!scanInteger(position, currentLine.end, segmentTypeIndex) || !scanFloat(position, currentLine.end, sigma) ||
+            !scanFloat(position, currentLine.end, sigmaCorr) || !scanInteger(position, currentLine.end, atomicNumber) ||
+            !scanInteger(position, currentLine.end, HBtype) || !scanInteger(position, currentLine.end, group) ||
+            !scanDouble(position, currentLine.end, area)) {
+            throwParseError(currentLine);
+        }
+
+        if (group < 0 || group > 6) {
+            throw std::runtime_error("The extended sigma profile " + path + " contains a segment type of the unknown group " + std::to_string(group) + ".");
+        }
+
+        segments.add(0, (unsigned short)group, sigma, sigmaCorr, (unsigned short)HBtype, (unsigned short)atomicNumber, area);
     }
 
-    newMolecule.segmentAtomIndices = Eigen::Map<Eigen::VectorXi>(segmentAtomIndices.data(), segmentAtomIndices.size());
-    newMolecule.segmentAreas = Eigen::Map<Eigen::VectorXd>(segmentAreas.data(), segmentAreas.size());
-    newMolecule.segmentSigmas = Eigen::Map<Eigen::VectorXd>(segmentSigmas.data(), segmentSigmas.size());
+    if (!settingsFound) {
+        throw std::runtime_error("The extended sigma profile " + path + " does not state the settings it was calculated with.");
+    }
+
+    for (std::string requiredKey : { "Area", "Volume", "epsilonInfinityTotalEnergy", "moleculeCharge", "moleculeGroup", "atomicNumbers" }) {
+        if (std::find(foundKeys.begin(), foundKeys.end(), requiredKey) == foundKeys.end()) {
+            throw std::runtime_error("The extended sigma profile " + path + " does not contain the following entry: " + requiredKey);
+        }
+    }
+
+    newMolecule.atomAtomicNumbers = Eigen::Map<Eigen::VectorXi>(atomicNumbers.data(), Eigen::Index(atomicNumbers.size()));
+
+    segments.sort();
+    segments.shrink_to_fit();
 
     return newMolecule;
 }
@@ -98,9 +98,7 @@ void loadParametersOnCLI(const json& parameters) {
 
 }
 
-void loadMoleculesOnCLI(const json& options, const json& parameters, const json& componentPaths) {
-
-    // options
+void loadOptionsOnCLI(const json& options) {
 
     if (param.sw_calculateContactStatisticsAndAdditionalProperties != 0) {
         const json& partialInteractionMatrices = options["sw_SR_partialInteractionMatrices"];
@@ -112,14 +110,48 @@ void loadMoleculesOnCLI(const json& options, const json& parameters, const json&
     if (param.sw_misfit < 0 || param.sw_misfit > 2) {
         throw std::runtime_error("sw_SR_misfit should have one of the following values: [0, 1, 2].");
     }
+    if (options.contains("sw_SR_reuseSolvedStates")) {
+        param.sw_reuseSolvedStates = options["sw_SR_reuseSolvedStates"].template get<int>();
+    }
+    if (options.contains("sw_SR_mergeEquivalentSegmentTypes")) {
+        param.sw_mergeEquivalentSegmentTypes = options["sw_SR_mergeEquivalentSegmentTypes"].template get<int>();
+    }
+    if (options.contains("sw_SR_sigmaGridCoarseningFactor")) {
+        param.sw_sigmaGridCoarseningFactor = options["sw_SR_sigmaGridCoarseningFactor"].template get<int>();
+        checkSigmaGridCoarseningFactor(param);
+    }
+    if (options.contains("sw_SR_sigmaAveragingWeightCutoff")) {
+        param.sw_sigmaAveragingWeightCutoff = options["sw_SR_sigmaAveragingWeightCutoff"].template get<double>();
+    }
+    if (options.contains("sw_SR_singlePrecisionSegmentDistances")) {
+        param.sw_singlePrecisionSegmentDistances = options["sw_SR_singlePrecisionSegmentDistances"].template get<int>();
+    }
+    if (options.contains("sw_SR_moleculeCacheDirectory")) {
+        param.sw_moleculeCacheDirectory = options["sw_SR_moleculeCacheDirectory"].template get<std::string>();
+    }
+    if (options.contains("sw_SR_moleculeLibraryPath")) {
+        param.sw_moleculeLibraryPath = options["sw_SR_moleculeLibraryPath"].template get<std::string>();
+    }
+    if (options.contains("sw_SR_extendedSigmaProfileDirectory")) {
+        param.sw_extendedSigmaProfileDirectory = options["sw_SR_extendedSigmaProfileDirectory"].template get<std::string>();
+    }
+    if (options.contains("sw_SR_deduplicateMolecules")) {
+        param.sw_deduplicateMolecules = options["sw_SR_deduplicateMolecules"].template get<int>();
+    }
+    if (options.contains("sw_SR_loadMoleculesOnDemand")) {
+        param.sw_loadMoleculesOnDemand = options["sw_SR_loadMoleculesOnDemand"].template get<int>();
+    }
+}
+
+void loadMoleculesOnCLI(const json& options, const json& parameters, const json& componentPaths) {
+
+    // options
+    loadOptionsOnCLI(options);
 
     // parameters
     loadParametersOnCLI(parameters);
 
-    for (const auto& componentPath : componentPaths) {
-        molecule newMolecule = loadNewMolecule(param, componentPath.template get<std::string>());
-        molecules.push_back(std::make_shared<molecule>(newMolecule));
-    }
+    addMolecules(param, componentPaths.template get<std::vector<std::string>>());
 
     if (molecules.size() == 0) {
         throw std::runtime_error("Please load at least one molecule.");
@@ -134,32 +166,61 @@ void loadCalculationsOnCLI(const json& calculationsOnCLI) {
         throw std::runtime_error("Please specify at least one calculation.");
     }
 
+    // calculations with identical components are merged into one calculation with more concentrations
+    // this avoids building the segments, Tau and the workspace more than once.
+    // The size of a merged calculation is limited by getMaximumNumberOfMergedConcentrations.
+    // calculationRequests maps every requested calculation to its concentrations in the merged calculation
+    std::vector<calculation> newCalculations;
+    newCalculations.reserve(numCalcs);
+    std::map<std::vector<int>, int> newCalculationIndexForComponents;
+    std::vector<int> newCalculationIndexOfRequest(numCalcs);
+
+    const int firstRequestIndex = int(calculationRequests.size());
+
+    // molecules loaded on demand are loaded together before building the calculations
+    std::vector<int> referencedMoleculeIndices;
+    size_t numberOfRequestedConcentrations = 0;
+    for (int i = 0; i < numCalcs; i++) {
+        std::vector<int> componentIndices = calculationsOnCLI[i]["component_indices"].template get<std::vector<int>>();
+        referencedMoleculeIndices.insert(referencedMoleculeIndices.end(), componentIndices.begin(), componentIndices.end());
+        numberOfRequestedConcentrations += calculationsOnCLI[i]["concentrations"].size();
+    }
+    loadReferencedMolecules(param, referencedMoleculeIndices);
+
+    // first all concentrations of the requests are added as these are the first rows of every calculation
     for (int i = 0; i < numCalcs; i++) {
 
         const json& calculationDict = calculationsOnCLI[i];
 
         // array of component indices
-        const json& componentList = calculationDict["component_indices"];
-        int numberOfComponents = int(componentList.size());
+        std::vector<int> componentIndices = calculationDict["component_indices"].template get<std::vector<int>>();
+        int numberOfComponents = int(componentIndices.size());
 
-        calculation newCalculation(numberOfComponents);
+        // a new calculation is started if the merged calculation would become too large
+        auto mergedCalculation = newCalculationIndexForComponents.find(componentIndices);
+        if (mergedCalculation == newCalculationIndexForComponents.end()
+            || newCalculations[mergedCalculation->second].concentrations.size() + calculationDict["concentrations"].size() > getMaximumNumberOfMergedConcentrations(numberOfRequestedConcentrations, numberOfComponents)) {
 
-        for (int j = 0; j < numberOfComponents; j++) {
-            std::shared_ptr<molecule> thisMolecule = molecules[componentList[j].get<int>()];
+            calculation newCalculation(numberOfComponents);
 
-            for (int k = 0; k < thisMolecule->segments.size(); k++) {
-                newCalculation.segments.add((unsigned short)j, thisMolecule->segments.SegmentTypeGroup[k],
-                    thisMolecule->segments.SegmentTypeSigma[k],
-                    thisMolecule->segments.SegmentTypeSigmaCorr[k],
-                    thisMolecule->segments.SegmentTypeHBtype[k],
-                    thisMolecule->segments.SegmentTypeAtomicNumber[k],
-                    thisMolecule->segments.SegmentTypeAreas[k][0]);
+            for (int j = 0; j < numberOfComponents; j++) {
+                newCalculation.components.push_back(molecules[componentIndices[j]]);
             }
+            buildCalculationSegments(param, newCalculation);
+            newCalculation.segments.shrink_to_fit();
 
-            newCalculation.components.push_back(thisMolecule);
+            newCalculation.number = (int)i;
+
+            newCalculationIndexForComponents[componentIndices] = int(newCalculations.size());
+            newCalculations.push_back(std::move(newCalculation));
         }
-        newCalculation.segments.sort();
-        newCalculation.segments.shrink_to_fit();
+
+        newCalculationIndexOfRequest[i] = newCalculationIndexForComponents[componentIndices];
+        calculation& newCalculation = newCalculations[newCalculationIndexOfRequest[i]];
+
+        calculationRequest newRequest;
+        newRequest.calculationIndex = int(calculations.size()) + newCalculationIndexOfRequest[i];
+        newRequest.firstConcentrationIndex = int(newCalculation.concentrations.size());
 
         // concentrations and temperatures
         auto temperatures = calculationDict["temperatures"].template get<std::vector<double>>();
@@ -185,17 +246,33 @@ void loadCalculationsOnCLI(const json& calculationsOnCLI) {
             newCalculation.concentrations.push_back(rowConcentration);
         }
 
+        newRequest.numberOfConcentrations = int(concentrations.size());
+        calculationRequests.push_back(newRequest);
+    }
+
+    for (int i = 0; i < newCalculations.size(); i++) {
+        newCalculations[i].originalNumberOfCalculations = newCalculations[i].concentrations.size();
+    }
+
+    // afterwards the reference states are added in the same order
+    for (int i = 0; i < numCalcs; i++) {
+
+        const json& calculationDict = calculationsOnCLI[i];
+        calculation& newCalculation = newCalculations[newCalculationIndexOfRequest[i]];
+        const calculationRequest& request = calculationRequests[firstRequestIndex + i];
+        int numberOfComponents = int(newCalculation.components.size());
+
+        auto temperatures = calculationDict["temperatures"].template get<std::vector<double>>();
+
         std::vector<std::vector<double>> referenceStateConcentrations;
         if (calculationDict.contains("reference_state_concentrations")) {
             referenceStateConcentrations = calculationDict["reference_state_concentrations"].template get<std::vector<std::vector<double>>>();
 
-            if (referenceStateConcentrations.size() != newCalculation.concentrations.size()) {
+            if (referenceStateConcentrations.size() != request.numberOfConcentrations) {
                 throw std::runtime_error("concentrations and referenceStateConcentrations of calculation number " + std::to_string(i) + " have different sizes.");
             }
         }
 
-        newCalculation.originalNumberOfCalculations = static_cast<unsigned short>(newCalculation.concentrations.size());
-
         // reference states
         auto referenceStateTypes = calculationDict["reference_state_types"].get<std::vector<int>>();
         for (int j = 0; j < referenceStateTypes.size(); j++) {
@@ -223,7 +300,7 @@ void loadCalculationsOnCLI(const json& calculationsOnCLI) {
                     }
 
                     float temperature = static_cast<float>(temperatures[j]);
-                    int referenceStateCalculationIndex = static_cast<int>(newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature));
+                    int referenceStateCalculationIndex = static_cast<int>(newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, request.firstConcentrationIndex, request.numberOfConcentrations));
                     thisReferenceStateCalculationIndices.push_back(referenceStateCalculationIndex);
                 }
                 newCalculation.referenceStateCalculationIndices.push_back(thisReferenceStateCalculationIndices);
@@ -242,7 +319,7 @@ void loadCalculationsOnCLI(const json& calculationsOnCLI) {
                         }
 
                         float temperature = static_cast<float>(temperatures[j]);
-                        int referenceStateCalculationIndex = static_cast<int>(newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature));
+                        int referenceStateCalculationIndex = static_cast<int>(newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, request.firstConcentrationIndex, request.numberOfConcentrations));
                         thisReferenceStateCalculationIndices.push_back(referenceStateCalculationIndex);
                     }
                     else {
@@ -266,7 +343,7 @@ void loadCalculationsOnCLI(const json& calculationsOnCLI) {
                 }
 
                 float temperature = static_cast<float>(temperatures[j]);
-                int referenceStateCalculationIndex = static_cast<int>(newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature));
+                int referenceStateCalculationIndex = static_cast<int>(newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, request.firstConcentrationIndex, request.numberOfConcentrations));
 
                 std::vector<int> thisReferenceStateCalculationIndices;
                 for (int m = 0; m < numberOfComponents; m++) {
@@ -286,108 +363,21 @@ void loadCalculationsOnCLI(const json& calculationsOnCLI) {
                 throw std::runtime_error("An unknown reference state type was given.");
             }
         }
+    }
 
-        // bind to matrices for it to work with the rest o the code
-
-        newCalculation.lnGammaCombinatorial_data = Eigen::MatrixXf(
-            int(newCalculation.originalNumberOfCalculations),
-            int(newCalculation.components.size()));
-
-        newCalculation.lnGammaCombinatorial_data.setZero();
-
-        new (&newCalculation.lnGammaCombinatorial) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
-            newCalculation.lnGammaCombinatorial_data.data(),
-            int(newCalculation.originalNumberOfCalculations),
-            int(newCalculation.components.size()));
-
-        newCalculation.lnGammaResidual_data = Eigen::MatrixXf(
-            int(newCalculation.originalNumberOfCalculations),
-            int(newCalculation.components.size()));
-
-        newCalculation.lnGammaResidual_data.setZero();
-
-        new (&newCalculation.lnGammaResidual) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
-            newCalculation.lnGammaResidual_data.data(),
-            int(newCalculation.originalNumberOfCalculations),
-            int(newCalculation.components.size()));
-
-        newCalculation.lnGammaTotal_data = Eigen::MatrixXf(
-            int(newCalculation.originalNumberOfCalculations),
-            int(newCalculation.components.size()));
-
-        newCalculation.lnGammaTotal_data.setZero();
-
-        new (&newCalculation.lnGammaTotal) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
-            newCalculation.lnGammaTotal_data.data(),
-            int(newCalculation.originalNumberOfCalculations),
-            int(newCalculation.components.size()));
-
-        newCalculation.dGsolv_data = Eigen::MatrixXf(
-            int(newCalculation.originalNumberOfCalculations),
-            int(newCalculation.components.size()));
-
-        newCalculation.dGsolv_data.setZero();
-
-        new (&newCalculation.dGsolv) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
-            newCalculation.dGsolv_data.data(),
-            int(newCalculation.originalNumberOfCalculations),
-            int(newCalculation.components.size()));
-
-        if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
-
-            newCalculation.contactStatistics_data = Eigen::Tensor<float, 3, Eigen::RowMajor>(
-                int(newCalculation.originalNumberOfCalculations),
-                int(newCalculation.components.size()),
-                int(newCalculation.components.size()));
-
-            newCalculation.contactStatistics_data.setZero();
-
-            new (&newCalculation.contactStatistics) Eigen::TensorMap<Eigen::Tensor<float, 3, Eigen::RowMajor>>(newCalculation.contactStatistics_data.data(),
-                int(newCalculation.originalNumberOfCalculations),
-                int(newCalculation.components.size()),
-                int(newCalculation.components.size()));
-
-
-            newCalculation.averageSurfaceEnergies_data = Eigen::Tensor<float, 4, Eigen::RowMajor>(
-                int(newCalculation.originalNumberOfCalculations),
-                int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
-                int(newCalculation.components.size()),
-                int(newCalculation.components.size()));
-
-            newCalculation.averageSurfaceEnergies_data.setZero();
-
-            new (&newCalculation.averageSurfaceEnergies) Eigen::TensorMap<Eigen::Tensor<float, 4, Eigen::RowMajor>>(newCalculation.averageSurfaceEnergies_data.data(),
-                int(newCalculation.originalNumberOfCalculations),
-                int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
-                int(newCalculation.components.size()),
-                int(newCalculation.components.size()));
-
-            if (param.sw_calculateContactStatisticsAndAdditionalProperties == 2) {
-
-                newCalculation.partialMolarEnergies_data = Eigen::Tensor<float, 3, Eigen::RowMajor>(
-                    int(newCalculation.originalNumberOfCalculations),
-                    int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
-                    int(newCalculation.components.size()));
-
-                newCalculation.partialMolarEnergies_data.setZero();
-
-                new (&newCalculation.partialMolarEnergies) Eigen::TensorMap<Eigen::Tensor<float, 3, Eigen::RowMajor>>(newCalculation.partialMolarEnergies_data.data(),
-                    int(newCalculation.originalNumberOfCalculations),
-                    int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
-                    int(newCalculation.components.size()));
-            }
+    // the reserve is very important as the Eigen::Map of the calculations already loaded
+    // would point to deleted matrices if the vector is reallocated
+    calculations.reserve(calculations.size() + newCalculations.size());
 
-        }
+    for (int i = 0; i < newCalculations.size(); i++) {
+        finishCalculationInitiation(newCalculations[i]);
+        calculations.push_back(std::move(newCalculations[i]));
 
-        newCalculation.number = (int)i;
-        finishCalculationInitiation(newCalculation);
-        // the following std::move statement is very important as otherwise the Eigen::Map
-        // are pointing to matrices deleted after exiting this function
-        calculations.push_back(std::move(newCalculation));
+        // bind to matrices for it to work with the rest of the code
+        bindCalculationOutputsToInternalData(param, calculations.back());
     }
 }
 
-
 int main(int argc, char** argv)
 {
     try {
@@ -395,6 +385,40 @@ int main(int argc, char** argv)
         initializeOnCLI();
         std::string inputFilePath;
         std::string outputFilePath;
+
+        // openCOSMORS --createMoleculeLibrary input.json library.ocrslib
+        // writes the molecules of the componentPaths in the input json file into a molecule library
+        if (argc == 4 && std::string(argv[1]) == "--createMoleculeLibrary") {
+            std::ifstream f(argv[2]);
+            if (f.fail())
+                throw std::runtime_error("The input json file path was not found. Does it exists? Is the path correct?");
+            json inputFileData = json::parse(f);
+
+            if (inputFileData.contains("sw_SR_moleculeCacheDirectory")) {
+                param.sw_moleculeCacheDirectory = inputFileData["sw_SR_moleculeCacheDirectory"].template get<std::string>();
+            }
+            createMoleculeLibrary(param, argv[3], inputFileData["componentPaths"].template get<std::vector<std::string>>());
+            return 0;
+        }
+
+        // openCOSMORS --writeSigmaProfiles input.json sigmaProfiles.ocrssp
+        // writes the sigma profiles, sigma moments and estimated molar volumes of the molecules of the componentPaths
+        // in the input json file into one sigma profile file, the calculations in the input json file are ignored.
+        // With sw_SR_moleculeCacheDirectory the averaged segment types and estimated molar volumes are reused on later runs
+        if (argc == 4 && std::string(argv[1]) == "--writeSigmaProfiles") {
+            std::ifstream f(argv[2]);
+            if (f.fail())
+                throw std::runtime_error("The input json file path was not found. Does it exists? Is the path correct?");
+            json inputFileData = json::parse(f);
+
+            loadOptionsOnCLI(inputFileData);
+            loadParametersOnCLI(inputFileData);
+            param.sw_estimateMolarVolume = 1;
+
+            writeSigmaProfileFile(param, argv[3], inputFileData["componentPaths"].template get<std::vector<std::string>>());
+            return 0;
+        }
+
         if (argc < 2) {
             throw std::runtime_error("The required input json file path was not given.");
         }
@@ -428,7 +452,7 @@ int main(int argc, char** argv)
 
         std::vector<int> calculationIndices = {};
 
-        for (int i = 0; i < inputFileData["calculations"].size(); i++)
+        for (int i = 0; i < calculations.size(); i++)
             calculationIndices.push_back(i);
 
         calculate(calculationIndices);
@@ -447,12 +471,14 @@ int main(int argc, char** argv)
         }
         outputJson["warnings"] = warnings;
 
-        for (int calculationIndex = 0; calculationIndex < inputFileData["calculations"].size(); calculationIndex++) {
+        for (int requestIndex = 0; requestIndex < calculationRequests.size(); requestIndex++) {
+            const calculationRequest& request = calculationRequests[requestIndex];
+            calculation& thisCalculation = calculations[request.calculationIndex];
             json dGsolv_thisCalculation;
-            for (int i = 0; i < calculations[calculationIndex].lnGammaTotal.rows(); i++) {
+            for (int i = request.firstConcentrationIndex; i < request.firstConcentrationIndex + request.numberOfConcentrations; i++) {
                 std::vector<float> dGsolv;
-                for (int j = 0; j < calculations[calculationIndex].lnGammaTotal.cols(); j++) {
-                    dGsolv.push_back(calculations[calculationIndex].dGsolv(i, j));
+                for (int j = 0; j < thisCalculation.lnGammaTotal.cols(); j++) {
+                    dGsolv.push_back(thisCalculation.dGsolv(i, j));
                 }
                 json dGsolv_vec(dGsolv);
                 dGsolv_thisCalculation.push_back(dGsolv_vec);
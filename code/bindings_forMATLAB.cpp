@@ -48,6 +48,16 @@ private:
 		return (T)val;
 	}
 
+	// optional options keep their default value if the field is missing
+	bool hasField(StructArray sArray, std::string fieldName) {
+		for (const MATLABFieldIdentifier& name : sArray.getFieldNames()) {
+			if (std::string(name) == fieldName) {
+				return true;
+			}
+		}
+		return false;
+	}
+
 public:
 
     MexFunction()
@@ -164,6 +174,41 @@ public:
 		if (param.sw_misfit < 0 && param.sw_misfit > 2) {
 			throw std::runtime_error("sw_SR_misfit should have one of the following values: [0, 1, 2].");
 		}
+
+		if (hasField(matlabStructArrayOpt, "sw_SR_reuseSolvedStates")) {
+			param.sw_reuseSolvedStates = getNumericFieldValue<int>(matlabStructArrayOpt, 0, "sw_SR_reuseSolvedStates");
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_deduplicateMolecules")) {
+			param.sw_deduplicateMolecules = getNumericFieldValue<int>(matlabStructArrayOpt, 0, "sw_SR_deduplicateMolecules");
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_mergeEquivalentSegmentTypes")) {
+			param.sw_mergeEquivalentSegmentTypes = getNumericFieldValue<int>(matlabStructArrayOpt, 0, "sw_SR_mergeEquivalentSegmentTypes");
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_sigmaGridCoarseningFactor")) {
+			param.sw_sigmaGridCoarseningFactor = getNumericFieldValue<int>(matlabStructArrayOpt, 0, "sw_SR_sigmaGridCoarseningFactor");
+			checkSigmaGridCoarseningFactor(param);
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_sigmaAveragingWeightCutoff")) {
+			param.sw_sigmaAveragingWeightCutoff = getNumericFieldValue<double>(matlabStructArrayOpt, 0, "sw_SR_sigmaAveragingWeightCutoff");
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_singlePrecisionSegmentDistances")) {
+			param.sw_singlePrecisionSegmentDistances = getNumericFieldValue<int>(matlabStructArrayOpt, 0, "sw_SR_singlePrecisionSegmentDistances");
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_moleculeCacheDirectory")) {
+			TypedArray<MATLABString> sw_moleculeCacheDirectory = matlabStructArrayOpt[0]["sw_SR_moleculeCacheDirectory"];
+			param.sw_moleculeCacheDirectory = sw_moleculeCacheDirectory[0];
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_moleculeLibraryPath")) {
+			TypedArray<MATLABString> sw_moleculeLibraryPath = matlabStructArrayOpt[0]["sw_SR_moleculeLibraryPath"];
+			param.sw_moleculeLibraryPath = sw_moleculeLibraryPath[0];
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_extendedSigmaProfileDirectory")) {
+			TypedArray<MATLABString> sw_extendedSigmaProfileDirectory = matlabStructArrayOpt[0]["sw_SR_extendedSigmaProfileDirectory"];
+			param.sw_extendedSigmaProfileDirectory = sw_extendedSigmaProfileDirectory[0];
+		}
+		if (hasField(matlabStructArrayOpt, "sw_SR_loadMoleculesOnDemand")) {
+			param.sw_loadMoleculesOnDemand = getNumericFieldValue<int>(matlabStructArrayOpt, 0, "sw_SR_loadMoleculesOnDemand");
+		}
 		
 		
 		// load parameters
@@ -342,14 +387,14 @@ public:
 
 		const size_t numComponents = cellArrayComponents.getNumberOfElements();
 
+		std::vector<std::string> componentPaths;
 		for (int i = 0; i < numComponents; i++) {
 			TypedArray<MATLABString> cPath = cellArrayComponents[i];
 			std::string componentPath = cPath[0];
-
-			molecule newMolecule = loadNewMolecule(param, componentPath);
-
-			molecules.push_back(std::move(std::make_shared<molecule>(newMolecule)));
+			componentPaths.push_back(componentPath);
 		}
+
+		addMolecules(param, componentPaths);
 	}
 
 	void loadCalculationsOnMATLAB(StructArray const matlabStructArrayCalc) {
@@ -377,6 +422,16 @@ public:
 			throw std::runtime_error("Please specify at least one calculation.");
 		}
 
+		// molecules loaded on demand are loaded together before building the calculations
+		std::vector<int> referencedMoleculeIndices;
+		for (int i = 0; i < numCalcs; i++) {
+			TypedArray<double> matlabArrayComponents = matlabStructArrayCalc[i]["components"];
+			for (int j = 0; j < matlabArrayComponents.getNumberOfElements(); j++) {
+				referencedMoleculeIndices.push_back(int(matlabArrayComponents[j]) - 1); // minus one because matlab indexing is one-based
+			}
+		}
+		loadReferencedMolecules(param, referencedMoleculeIndices);
+
 		for (int i = 0; i < numCalcs; i++) {
 			
 			// array of component indices
@@ -384,18 +439,9 @@ public:
 			int numberOfComponents = int(matlabArrayComponents.getNumberOfElements());
 			calculation newCalculation(numberOfComponents);
 			for (int j = 0; j < numberOfComponents; j++) {
-				std::shared_ptr<molecule> thisMolecule = molecules[int(matlabArrayComponents[j]) - 1]; // minus one because matlab indexing is one-based
-				for (int k = 0; k < thisMolecule->segments.size(); k++) {
-					newCalculation.segments.add(j, thisMolecule->segments.SegmentTypeGroup[k],
-						thisMolecule->segments.SegmentTypeSigma[k],
-						thisMolecule->segments.SegmentTypeSigmaCorr[k],
-						thisMolecule->segments.SegmentTypeHBtype[k],
-						thisMolecule->segments.SegmentTypeAtomicNumber[k],
-						thisMolecule->segments.SegmentTypeAreas[k][0]);
-				}
-				newCalculation.components.push_back(thisMolecule);
+				newCalculation.components.push_back(molecules[int(matlabArrayComponents[j]) - 1]); // minus one because matlab indexing is one-based
 			}
-			newCalculation.segments.sort();
+			buildCalculationSegments(param, newCalculation);
 			newCalculation.segments.shrink_to_fit();
 			// temperature
 			TypedArray<double> matlabArrayTemperatures = matlabStructArrayCalc[i]["temperatures"];
@@ -461,7 +507,7 @@ public:
 						}
 
 						float temperature = newCalculation.temperatures[j];
-						int referenceStateCalculationIndex = newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature);
+						int referenceStateCalculationIndex = newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, 0, int(newCalculation.originalNumberOfCalculations));
 
 						thisReferenceStateCalculationIndices.push_back(referenceStateCalculationIndex);
 
@@ -484,7 +530,7 @@ public:
 							}
 
 							float temperature = newCalculation.temperatures[0];
-							int referenceStateCalculationIndex = newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature);
+							int referenceStateCalculationIndex = newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, 0, int(newCalculation.originalNumberOfCalculations));
 
 							thisReferenceStateCalculationIndices.push_back(referenceStateCalculationIndex);
 						}
@@ -510,7 +556,7 @@ public:
 					}
 
 					float temperature = newCalculation.temperatures[j];
-					int referenceStateCalculationIndex = newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature);
+					int referenceStateCalculationIndex = newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, 0, int(newCalculation.originalNumberOfCalculations));
 
 					std::vector<int> thisReferenceStateCalculationIndices;
 					for (int m = 0; m < newCalculation.components.size(); m++) {
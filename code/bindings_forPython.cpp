@@ -15,6 +15,25 @@ using namespace pybind11::literals;
 #include "general.hpp"
 #include "core_functions.hpp"
 
+// the numpy arrays of a requested calculation the results are written to, taken when loading the calculations.
+// A calculation serving a single request is bound to them directly, the results of calculations merged from
+// several requests are copied to them after calculating
+struct requestOutputArrays {
+	bool isBound = false;
+
+	float* lnGammaCombinatorial = NULL;
+	float* lnGammaResidual = NULL;
+	float* lnGammaTotal = NULL;
+
+	float* dGsolv = NULL;
+	int numberOfDGsolvColumns = 0;
+
+	float* contactStatistics = NULL;
+	float* averageSurfaceEnergies = NULL;
+	float* partialMolarEnergies = NULL;
+};
+std::vector<requestOutputArrays> outputArraysOfRequests; // for every entry of calculationRequests
+
 void displayOnPython(std::string message) {
 	py::print(message, "end"_a = "");
 }
@@ -134,21 +153,161 @@ void loadMoleculesOnPython(py::dict options, py::dict parameters, py::list compo
 		throw std::runtime_error("sw_SR_misfit should have one of the following values: [0, 1, 2].");
 	}
 	param.sw_skip_COSMOSPACE_errors = options["sw_skip_COSMOSPACE_errors"].cast<int>();
+	if (options.contains("sw_SR_reuseSolvedStates")) {
+		param.sw_reuseSolvedStates = options["sw_SR_reuseSolvedStates"].cast<int>();
+	}
+	if (options.contains("sw_SR_mergeEquivalentSegmentTypes")) {
+		param.sw_mergeEquivalentSegmentTypes = options["sw_SR_mergeEquivalentSegmentTypes"].cast<int>();
+	}
+	if (options.contains("sw_SR_sigmaGridCoarseningFactor")) {
+		param.sw_sigmaGridCoarseningFactor = options["sw_SR_sigmaGridCoarseningFactor"].cast<int>();
+		checkSigmaGridCoarseningFactor(param);
+	}
+	if (options.contains("sw_SR_sigmaAveragingWeightCutoff")) {
+		param.sw_sigmaAveragingWeightCutoff = options["sw_SR_sigmaAveragingWeightCutoff"].cast<double>();
+	}
+	if (options.contains("sw_SR_moleculeCacheDirectory")) {
+		param.sw_moleculeCacheDirectory = options["sw_SR_moleculeCacheDirectory"].cast<std::string>();
+	}
+	if (options.contains("sw_SR_moleculeLibraryPath")) {
+		param.sw_moleculeLibraryPath = options["sw_SR_moleculeLibraryPath"].cast<std::string>();
+	}
+	if (options.contains("sw_SR_extendedSigmaProfileDirectory")) {
+		param.sw_extendedSigmaProfileDirectory = options["sw_SR_extendedSigmaProfileDirectory"].cast<std::string>();
+	}
+	if (options.contains("sw_SR_deduplicateMolecules")) {
+		param.sw_deduplicateMolecules = options["sw_SR_deduplicateMolecules"].cast<int>();
+	}
+	if (options.contains("sw_SR_loadMoleculesOnDemand")) {
+		param.sw_loadMoleculesOnDemand = options["sw_SR_loadMoleculesOnDemand"].cast<int>();
+	}
+	if (options.contains("sw_SR_singlePrecisionSegmentDistances")) {
+		param.sw_singlePrecisionSegmentDistances = options["sw_SR_singlePrecisionSegmentDistances"].cast<int>();
+	}
 
 	// parameters
 	loadParametersOnPython(parameters);
 
+	std::vector<std::string> paths;
 	for (auto componentPath : componentPaths) {
-		molecule newMolecule = loadNewMolecule(param, componentPath.cast<std::string>());
-		molecules.push_back(std::make_shared<molecule>(newMolecule));
+		paths.push_back(componentPath.cast<std::string>());
 	}
 
+	addMolecules(param, paths);
+
 	if (molecules.size() == 0) {
 		throw std::runtime_error("Please load at least one molecule.");
 	}
 
 }
 
+void createMoleculeLibraryOnPython(py::dict options, std::string libraryPath, py::list componentPaths) {
+
+	parameters libraryParameters;
+	libraryParameters.sw_COSMOfiles_type = options["sw_SR_COSMOfiles_type"].cast<std::string>();
+	if (options.contains("sw_SR_moleculeCacheDirectory")) {
+		libraryParameters.sw_moleculeCacheDirectory = options["sw_SR_moleculeCacheDirectory"].cast<std::string>();
+	}
+
+	std::vector<std::string> paths;
+	for (auto componentPath : componentPaths) {
+		paths.push_back(componentPath.cast<std::string>());
+	}
+
+	createMoleculeLibrary(libraryParameters, libraryPath, paths);
+}
+
+// the data of a numpy array of a calculation the results are written to.
+// for this to work correctly the sizes of the n-dimensional numpy arrays and the type
+// must be the same in python and c++ (float32/float) with same storage order: row major.
+float* getOutputArrayData(py::dict calculationDict, const char* key, size_t expectedSize) {
+
+	py::object outputArray = calculationDict[key];
+	if (py::isinstance<py::array_t<float, py::array::c_style>>(outputArray) == false) {
+		throw std::runtime_error(std::string("The output array ") + key + " of a calculation has to be a row major numpy array of type float32.");
+	}
+
+	py::array_t<float, py::array::c_style> array = outputArray.cast<py::array_t<float, py::array::c_style>>();
+	if (size_t(array.size()) != expectedSize) {
+		throw std::runtime_error(std::string("The output array ") + key + " of a calculation has the wrong size.");
+	}
+	return array.mutable_data();
+}
+
+requestOutputArrays getRequestOutputArrays(py::dict calculationDict, int numberOfRows, int numberOfComponents) {
+
+	requestOutputArrays outputArrays;
+
+	size_t numberOfValues = size_t(numberOfRows) * numberOfComponents;
+	outputArrays.lnGammaCombinatorial = getOutputArrayData(calculationDict, "ln_gamma_x_SR_combinatorial_calc", numberOfValues);
+	outputArrays.lnGammaResidual = getOutputArrayData(calculationDict, "ln_gamma_x_SR_residual_calc", numberOfValues);
+	outputArrays.lnGammaTotal = getOutputArrayData(calculationDict, "ln_gamma_x_SR_calc", numberOfValues);
+
+	if (calculationDict.contains("dGsolv")) {
+		py::array_t<float, py::array::c_style> array = calculationDict["dGsolv"].cast<py::array_t<float, py::array::c_style>>();
+		outputArrays.numberOfDGsolvColumns = numberOfRows > 0 ? int(array.size()) / numberOfRows : 0;
+		outputArrays.dGsolv = getOutputArrayData(calculationDict, "dGsolv", size_t(numberOfRows) * outputArrays.numberOfDGsolvColumns);
+	}
+
+	if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
+
+		const int numberOfInteractionMatrices = param.numberOfPartialInteractionMatrices + 1; // +1 because A_int is the first one
+
+		outputArrays.contactStatistics = getOutputArrayData(calculationDict, "contact_statistics", numberOfValues * numberOfComponents);
+		outputArrays.averageSurfaceEnergies = getOutputArrayData(calculationDict, "average_surface_energies", numberOfValues * numberOfInteractionMatrices * numberOfComponents);
+
+		if (param.sw_calculateContactStatisticsAndAdditionalProperties == 2) {
+			outputArrays.partialMolarEnergies = getOutputArrayData(calculationDict, "partial_molar_energies", numberOfValues * numberOfInteractionMatrices);
+		}
+	}
+
+	return outputArrays;
+}
+
+// directly binds the outputs of a calculation serving a single request to its numpy arrays, so that they
+// are filled while calculating. The solvation energies stay in the internal data and are copied.
+void bindCalculationOutputsToNumpyArrays(calculation& _calculation, requestOutputArrays& outputArrays) {
+
+	const int numberOfRows = int(_calculation.originalNumberOfCalculations);
+	const int numberOfComponents = int(_calculation.components.size());
+
+	new (&_calculation.lnGammaCombinatorial) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(outputArrays.lnGammaCombinatorial,
+		numberOfRows, numberOfComponents);
+	_calculation.lnGammaCombinatorial_data.resize(0, 0);
+
+	new (&_calculation.lnGammaResidual) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(outputArrays.lnGammaResidual,
+		numberOfRows, numberOfComponents);
+	_calculation.lnGammaResidual_data.resize(0, 0);
+
+	new (&_calculation.lnGammaTotal) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(outputArrays.lnGammaTotal,
+		numberOfRows, numberOfComponents);
+	_calculation.lnGammaTotal_data.resize(0, 0);
+
+	if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
+
+		new (&_calculation.contactStatistics) Eigen::TensorMap<Eigen::Tensor<float, 3, Eigen::RowMajor>>(outputArrays.contactStatistics,
+			numberOfRows, numberOfComponents, numberOfComponents);
+		_calculation.contactStatistics_data = Eigen::Tensor<float, 3, Eigen::RowMajor>();
+
+		new (&_calculation.averageSurfaceEnergies) Eigen::TensorMap<Eigen::Tensor<float, 4, Eigen::RowMajor>>(outputArrays.averageSurfaceEnergies,
+			numberOfRows,
+			int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
+			numberOfComponents, numberOfComponents);
+		_calculation.averageSurfaceEnergies_data = Eigen::Tensor<float, 4, Eigen::RowMajor>();
+
+		if (param.sw_calculateContactStatisticsAndAdditionalProperties == 2) {
+
+			new (&_calculation.partialMolarEnergies) Eigen::TensorMap<Eigen::Tensor<float, 3, Eigen::RowMajor>>(outputArrays.partialMolarEnergies,
+				numberOfRows,
+				int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
+				numberOfComponents);
+			_calculation.partialMolarEnergies_data = Eigen::Tensor<float, 3, Eigen::RowMajor>();
+		}
+	}
+
+	outputArrays.isBound = true;
+}
+
 void loadCalculationsOnPython(py::list calculationsOnPython, bool reload = false) {
 
 	n_ex += 1;
@@ -176,32 +335,71 @@ void loadCalculationsOnPython(py::list calculationsOnPython, bool reload = false
 		throw std::runtime_error("Please specify at least one calculation.");
 	}
 
+	// calculations with identical components are merged into one calculation with more concentrations
+	// this avoids building the segments, Tau and the workspace more than once.
+	// The size of a merged calculation is limited by getMaximumNumberOfMergedConcentrations.
+	// calculationRequests maps every requested calculation to its concentrations in the merged calculation
+	// the results are copied to the numpy arrays of the requested calculations after calculating
+	std::vector<calculation> newCalculations;
+	newCalculations.reserve(numCalcs);
+	std::map<std::vector<int>, int> newCalculationIndexForComponents;
+	std::vector<int> newCalculationIndexOfRequest(numCalcs);
+
+	const int firstRequestIndex = int(calculationRequests.size());
+	outputArraysOfRequests.resize(calculationRequests.size());
+
+	// molecules loaded on demand are loaded together before building the calculations
+	std::vector<int> referencedMoleculeIndices;
+	size_t numberOfRequestedConcentrations = 0;
+	for (int i = 0; i < numCalcs; i++) {
+		py::dict calculationDict = calculationsOnPython[i];
+		py::list componentList = calculationDict["component_indices"];
+		for (auto componentIndex : componentList) {
+			referencedMoleculeIndices.push_back(componentIndex.cast<int>());
+		}
+		numberOfRequestedConcentrations += size_t(py::array_t<double>(calculationDict["concentrations"]).shape(0));
+	}
+	loadReferencedMolecules(param, referencedMoleculeIndices);
+
+	// first all concentrations of the requests are added as these are the first rows of every calculation
 	for (int i = 0; i < numCalcs; i++) {
 
 		py::dict calculationDict = calculationsOnPython[i];
 
 		// array of component indices
- 		py::list componentList = calculationDict["component_indices"];
-		int numberOfComponents = int(componentList.size());
+		py::list componentList = calculationDict["component_indices"];
+		std::vector<int> componentIndices;
+		for (auto componentIndex : componentList) {
+			componentIndices.push_back(componentIndex.cast<int>());
+		}
+		int numberOfComponents = int(componentIndices.size());
+		size_t numberOfConcentrations = size_t(py::array_t<double>(calculationDict["concentrations"]).shape(0));
 
-		calculation newCalculation(numberOfComponents);
+		// a new calculation is started if the merged calculation would become too large
+		auto mergedCalculation = newCalculationIndexForComponents.find(componentIndices);
+		if (mergedCalculation == newCalculationIndexForComponents.end()
+			|| newCalculations[mergedCalculation->second].concentrations.size() + numberOfConcentrations > getMaximumNumberOfMergedConcentrations(numberOfRequestedConcentrations, numberOfComponents)) {
 
-		for (int j = 0; j < numberOfComponents; j++) {
-			std::shared_ptr<molecule> thisMolecule = molecules[componentList[j].cast<int>()];
+			calculation newCalculation(numberOfComponents);
 
-			for (int k = 0; k < thisMolecule->segments.size(); k++) {
-				newCalculation.segments.add((unsigned short)j, thisMolecule->segments.SegmentTypeGroup[k],
-					thisMolecule->segments.SegmentTypeSigma[k],
-					thisMolecule->segments.SegmentTypeSigmaCorr[k],
-					thisMolecule->segments.SegmentTypeHBtype[k],
-					thisMolecule->segments.SegmentTypeAtomicNumber[k],
-					thisMolecule->segments.SegmentTypeAreas[k][0]);
+			for (int j = 0; j < numberOfComponents; j++) {
+				newCalculation.components.push_back(molecules[componentIndices[j]]);
 			}
+			buildCalculationSegments(param, newCalculation);
+			newCalculation.segments.shrink_to_fit();
 
-			newCalculation.components.push_back(thisMolecule);
+			newCalculation.number = (int)i;
+
+			newCalculationIndexForComponents[componentIndices] = int(newCalculations.size());
+			newCalculations.push_back(std::move(newCalculation));
 		}
-		newCalculation.segments.sort();
-		newCalculation.segments.shrink_to_fit();
+
+		newCalculationIndexOfRequest[i] = newCalculationIndexForComponents[componentIndices];
+		calculation& newCalculation = newCalculations[newCalculationIndexOfRequest[i]];
+
+		calculationRequest newRequest;
+		newRequest.calculationIndex = int(calculations.size()) + newCalculationIndexOfRequest[i];
+		newRequest.firstConcentrationIndex = int(newCalculation.concentrations.size());
 
 		// concentrations and temperatures
 		auto temperatures = py::array_t<double>(calculationDict["temperatures"]).unchecked<1>();
@@ -228,14 +426,30 @@ void loadCalculationsOnPython(py::list calculationsOnPython, bool reload = false
 			newCalculation.concentrations.push_back(rowConcentration);
 		}
 
+		newRequest.numberOfConcentrations = int(concentrations.shape(0));
+		calculationRequests.push_back(newRequest);
+		outputArraysOfRequests.push_back(getRequestOutputArrays(calculationDict, newRequest.numberOfConcentrations, numberOfComponents));
+	}
+
+	for (int i = 0; i < newCalculations.size(); i++) {
+		newCalculations[i].originalNumberOfCalculations = newCalculations[i].concentrations.size();
+	}
+
+	// afterwards the reference states are added in the same order
+	for (int i = 0; i < numCalcs; i++) {
+
+		py::dict calculationDict = calculationsOnPython[i];
+		calculation& newCalculation = newCalculations[newCalculationIndexOfRequest[i]];
+		const calculationRequest& request = calculationRequests[firstRequestIndex + i];
+		int numberOfComponents = int(newCalculation.components.size());
+
+		auto temperatures = py::array_t<double>(calculationDict["temperatures"]).unchecked<1>();
 		auto referenceStateConcentrations = py::array_t<double>(calculationDict["reference_state_concentrations"]).unchecked<2>();
 
-		if (referenceStateConcentrations.shape(0) != newCalculation.concentrations.size()) {
+		if (referenceStateConcentrations.shape(0) != request.numberOfConcentrations) {
 			throw std::runtime_error("concentrations and referenceStateConcentrations of calculation number " + std::to_string(i) + " have different sizes.\n");
 		}
 
-		newCalculation.originalNumberOfCalculations = (unsigned short)newCalculation.concentrations.size();
-
 		// reference states
 		auto referenceStateTypes = py::array_t<int>(calculationDict["reference_state_types"]).unchecked<1>();
 		for (int j = 0; j < (size_t)referenceStateTypes.shape(0); j++) {
@@ -268,7 +482,7 @@ void loadCalculationsOnPython(py::list calculationsOnPython, bool reload = false
 					}
 
 					float temperature = (float)temperatures(j);
-					int referenceStateCalculationIndex = (int)newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature);
+					int referenceStateCalculationIndex = (int)newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, request.firstConcentrationIndex, request.numberOfConcentrations);
 					thisReferenceStateCalculationIndices.push_back(referenceStateCalculationIndex);
 
 				}
@@ -291,7 +505,7 @@ void loadCalculationsOnPython(py::list calculationsOnPython, bool reload = false
 						}
 
 						float temperature = (float)temperatures(j);
-						int referenceStateCalculationIndex = (int)newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature);
+						int referenceStateCalculationIndex = (int)newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, request.firstConcentrationIndex, request.numberOfConcentrations);
 						thisReferenceStateCalculationIndices.push_back(referenceStateCalculationIndex);
 					}
 					else {
@@ -317,7 +531,7 @@ void loadCalculationsOnPython(py::list calculationsOnPython, bool reload = false
 				}
 
 				float temperature = (float)temperatures(j);
-				int referenceStateCalculationIndex = (int)newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature);
+				int referenceStateCalculationIndex = (int)newCalculation.addOrFindArrayIndexForConcentration(referenceStateConcentration, temperature, request.firstConcentrationIndex, request.numberOfConcentrations);
 
 				std::vector<int> thisReferenceStateCalculationIndices;
 				for (int m = 0; m < numberOfComponents; m++) {
@@ -338,63 +552,74 @@ void loadCalculationsOnPython(py::list calculationsOnPython, bool reload = false
 				throw std::runtime_error("An unknown reference state type was given.");
 			}
 		}
+	}
 
-		// directly bind to python numpy arrays
-		// for this to work correctly the sizes of the n-dimensional numpy arrays and the type
-		// must be the same in python and c++ (float32/float) with same storage order: row major.
-
-		py::array_t<float> tempArray = py::array_t<float>(calculationDict["ln_gamma_x_SR_combinatorial_calc"]);
-		new (&newCalculation.lnGammaCombinatorial) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(tempArray.mutable_data(),
-			int(newCalculation.originalNumberOfCalculations),
-			int(newCalculation.components.size()));
-
-		tempArray = py::array_t<float>(calculationDict["ln_gamma_x_SR_residual_calc"]);
-		new (&newCalculation.lnGammaResidual) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(tempArray.mutable_data(),
-			int(newCalculation.originalNumberOfCalculations),
-			int(newCalculation.components.size()));
-
-		tempArray = py::array_t<float>(calculationDict["ln_gamma_x_SR_calc"]);
-		new (&newCalculation.lnGammaTotal) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(tempArray.mutable_data(),
-			int(newCalculation.originalNumberOfCalculations),
-			int(newCalculation.components.size()));
-
-		if (calculationDict.contains("dGsolv")) {
-			tempArray = py::array_t<float>(calculationDict["dGsolv"]);
-			new (&newCalculation.dGsolv) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(tempArray.mutable_data(),
-				int(newCalculation.originalNumberOfCalculations),
-				1);
-		}
+	// the reserve is very important as the Eigen::Map of the calculations already loaded
+	// would point to deleted matrices if the vector is reallocated
+	calculations.reserve(calculations.size() + newCalculations.size());
 
-		if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
+	std::vector<int> numberOfRequestsOfNewCalculation(newCalculations.size(), 0);
+	for (int i = 0; i < numCalcs; i++) {
+		numberOfRequestsOfNewCalculation[newCalculationIndexOfRequest[i]]++;
+	}
 
-			tempArray = py::array_t<float>(calculationDict["contact_statistics"]);
-			new (&newCalculation.contactStatistics) Eigen::TensorMap<Eigen::Tensor<float, 3, Eigen::RowMajor>>(tempArray.mutable_data(),
-				int(newCalculation.originalNumberOfCalculations),
-				int(newCalculation.components.size()),
-				int(newCalculation.components.size()));
+	for (int i = 0; i < newCalculations.size(); i++) {
+		finishCalculationInitiation(newCalculations[i]);
+		calculations.push_back(std::move(newCalculations[i]));
 
-			tempArray = py::array_t<float>(calculationDict["average_surface_energies"]);
-			new (&newCalculation.averageSurfaceEnergies) Eigen::TensorMap<Eigen::Tensor<float, 4, Eigen::RowMajor>>(tempArray.mutable_data(),
-				int(newCalculation.originalNumberOfCalculations),
-				int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
-				int(newCalculation.components.size()),
-				int(newCalculation.components.size()));
+		// merged calculations can not be bound directly to the numpy arrays,
+		// these are filled by copyResultsToPython after calculating
+		bindCalculationOutputsToInternalData(param, calculations.back());
+	}
 
-			if (param.sw_calculateContactStatisticsAndAdditionalProperties == 2) {
+	for (int i = 0; i < numCalcs; i++) {
+		if (numberOfRequestsOfNewCalculation[newCalculationIndexOfRequest[i]] == 1) {
+			bindCalculationOutputsToNumpyArrays(calculations[calculationRequests[firstRequestIndex + i].calculationIndex], outputArraysOfRequests[firstRequestIndex + i]);
+		}
+	}
+}
 
-				tempArray = py::array_t<float>(calculationDict["partial_molar_energies"]);
-				new (&newCalculation.partialMolarEnergies) Eigen::TensorMap<Eigen::Tensor<float, 3, Eigen::RowMajor>>(tempArray.mutable_data(),
-				int(newCalculation.originalNumberOfCalculations),
-				int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
-				int(newCalculation.components.size()));
+// copies the results of a requested calculation from the merged calculation to its numpy arrays,
+// the solvation energies are always copied as their numpy arrays may have less columns than components
+void copyResultsToPython(const calculationRequest& request, const requestOutputArrays& outputArrays) {
+
+	calculation& thisCalculation = calculations[request.calculationIndex];
+
+	const int numberOfComponents = int(thisCalculation.components.size());
+	const int firstRow = request.firstConcentrationIndex;
+	const int numberOfRows = request.numberOfConcentrations;
+
+	if (outputArrays.dGsolv != NULL) {
+		for (int h = 0; h < numberOfRows; h++) {
+			for (int j = 0; j < std::min(outputArrays.numberOfDGsolvColumns, numberOfComponents); j++) {
+				outputArrays.dGsolv[h * outputArrays.numberOfDGsolvColumns + j] = thisCalculation.dGsolv(firstRow + h, j);
 			}
 		}
-		
-		newCalculation.number = (int)i;
-		finishCalculationInitiation(newCalculation);
-		calculations.push_back(newCalculation);
 	}
 
+	if (outputArrays.isBound)
+		return;
+
+	std::copy_n(thisCalculation.lnGammaCombinatorial.data() + firstRow * numberOfComponents, numberOfRows * numberOfComponents, outputArrays.lnGammaCombinatorial);
+	std::copy_n(thisCalculation.lnGammaResidual.data() + firstRow * numberOfComponents, numberOfRows * numberOfComponents, outputArrays.lnGammaResidual);
+	std::copy_n(thisCalculation.lnGammaTotal.data() + firstRow * numberOfComponents, numberOfRows * numberOfComponents, outputArrays.lnGammaTotal);
+
+	if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
+
+		const int numberOfInteractionMatrices = param.numberOfPartialInteractionMatrices + 1; // +1 because A_int is the first one
+
+		std::copy_n(thisCalculation.contactStatistics.data() + firstRow * numberOfComponents * numberOfComponents,
+			numberOfRows * numberOfComponents * numberOfComponents, outputArrays.contactStatistics);
+
+		std::copy_n(thisCalculation.averageSurfaceEnergies.data() + firstRow * numberOfInteractionMatrices * numberOfComponents * numberOfComponents,
+			numberOfRows * numberOfInteractionMatrices * numberOfComponents * numberOfComponents, outputArrays.averageSurfaceEnergies);
+
+		if (param.sw_calculateContactStatisticsAndAdditionalProperties == 2) {
+
+			std::copy_n(thisCalculation.partialMolarEnergies.data() + firstRow * numberOfInteractionMatrices * numberOfComponents,
+				numberOfRows * numberOfInteractionMatrices * numberOfComponents, outputArrays.partialMolarEnergies);
+		}
+	}
 }
 
 py::list calculateOnPython(py::dict parameters, py::list calculationsOnPython, bool reloadConcentrations = false, bool reloadReferenceConcentrations = false) {
@@ -419,11 +644,19 @@ py::list calculateOnPython(py::dict parameters, py::list calculationsOnPython, b
 	}
 
 	const size_t numCalcs = calculationsOnPython.size();
-	std::vector<int> calculationIndices(numCalcs);
+	std::vector<int> requestIndices(numCalcs);
+	std::vector<int> calculationIndices;
 
 	for (int i = 0; i < numCalcs; i++) {
 
-		calculationIndices[i] = calculationsOnPython[i]["index"].cast<int>();
+		requestIndices[i] = calculationsOnPython[i]["index"].cast<int>();
+		const calculationRequest& request = calculationRequests[requestIndices[i]];
+		calculation& thisCalculation = calculations[request.calculationIndex];
+
+		// requests with identical components share one calculation which is only calculated once
+		if (std::find(calculationIndices.begin(), calculationIndices.end(), request.calculationIndex) == calculationIndices.end()) {
+			calculationIndices.push_back(request.calculationIndex);
+		}
 
 		param.sw_reloadConcentrations = 0;
 		param.sw_reloadReferenceConcentrations = 0;
@@ -431,17 +664,15 @@ py::list calculateOnPython(py::dict parameters, py::list calculationsOnPython, b
 		if (reloadConcentrations == true) {
 			param.sw_reloadConcentrations = 1;
 			auto concentrations = py::array_t<double>(calculationsOnPython[i]["concentrations"]).unchecked<2>();
-			for (int h = 0; h < calculations[calculationIndices[i]].originalNumberOfCalculations; h++) {
-
-				int j = calculations[calculationIndices[i]].actualConcentrationIndices[h];
+			for (int h = 0; h < request.numberOfConcentrations; h++) {
 
-				std::vector<float> rowConcentration;
+				int j = thisCalculation.actualConcentrationIndices[request.firstConcentrationIndex + h];
 
 				float tempSumOfConcentrations = 0;
-				for (int k = 0; k < calculations[calculationIndices[i]].components.size(); k++) {
+				for (int k = 0; k < thisCalculation.components.size(); k++) {
 					float val = (float)concentrations(h, k);
 					tempSumOfConcentrations += val;
-					calculations[calculationIndices[i]].concentrations[j][k] = val;
+					thisCalculation.concentrations[j][k] = val;
 				}
 
 				if (abs(1.0f - tempSumOfConcentrations) > MAX_CONCENTRATION_DIFF_FROM_ZERO) {
@@ -461,20 +692,36 @@ py::list calculateOnPython(py::dict parameters, py::list calculationsOnPython, b
 					throw std::runtime_error("reloadReferenceConcentrations only makes sense if the referenceStateTypes == 2.\n");
 				}
 			}
-			if (calculations[calculationIndices[i]].concentrations.size() != calculations[calculationIndices[i]].originalNumberOfCalculations * 2) {
-				throw std::runtime_error("The implementation currently assumes that every concentratoin has a unique reference concentration, this could and should be changed in the future.\n");
+			// the reference concentrations of merged requests may be shared with the rows of other requests
+			// which would be changed as well, every concentration needs a reference concentration of its own
+			std::vector<int> numberOfUsesOfRow(thisCalculation.concentrations.size(), 0);
+			for (int h = 0; h < thisCalculation.originalNumberOfCalculations; h++) {
+				const std::vector<int>& referenceStateCalculationIndices = thisCalculation.referenceStateCalculationIndices[h];
+				for (int k = 0; k < referenceStateCalculationIndices.size(); k++) {
+					// a reference mixture uses the same row for all components
+					if (referenceStateCalculationIndices[k] >= 0 && (thisCalculation.referenceStateType[h] != 2 || k == 0)) {
+						numberOfUsesOfRow[referenceStateCalculationIndices[k]]++;
+					}
+				}
+			}
+			for (int h = request.firstConcentrationIndex; h < request.firstConcentrationIndex + request.numberOfConcentrations; h++) {
+				int referenceStateCalculationIndex = thisCalculation.referenceStateCalculationIndices[h][0];
+				if (referenceStateCalculationIndex < thisCalculation.originalNumberOfCalculations || numberOfUsesOfRow[referenceStateCalculationIndex] != 1) {
+					throw std::runtime_error("The implementation currently assumes that every concentration has a unique reference concentration, this could and should be changed in the future.\n");
+				}
 			}
 
-			for (int h = 0; h < calculations[calculationIndices[i]].originalNumberOfCalculations; h++) {
+			for (int h = 0; h < request.numberOfConcentrations; h++) {
 
-				std::vector<int> referenceStateCalculationIndices = calculations[calculationIndices[i]].referenceStateCalculationIndices[h];
+				std::vector<int> referenceStateCalculationIndices = thisCalculation.referenceStateCalculationIndices[request.firstConcentrationIndex + h];
 
 				float tempSumOfConcentrations = 0;
-				for (int k = 0; k < calculations[calculationIndices[i]].components.size(); k++) {
-					int referenceStateCalculationIndex = referenceStateCalculationIndices[k];
+				for (int k = 0; k < thisCalculation.components.size(); k++) {
+					// concentrations are saved sorted by conditions
+					int referenceStateCalculationIndex = thisCalculation.actualConcentrationIndices[referenceStateCalculationIndices[k]];
 					float val = (float)referenceStateConcentrations(h, k);
 					tempSumOfConcentrations += val;
-					calculations[calculationIndices[i]].concentrations[referenceStateCalculationIndex][k] = val;
+					thisCalculation.concentrations[referenceStateCalculationIndex][k] = val;
 				}
 
 				if (abs(1.0f - tempSumOfConcentrations) > MAX_CONCENTRATION_DIFF_FROM_ZERO) {
@@ -486,6 +733,10 @@ py::list calculateOnPython(py::dict parameters, py::list calculationsOnPython, b
 
 	calculate(calculationIndices);
 
+	for (int i = 0; i < numCalcs; i++) {
+		copyResultsToPython(calculationRequests[requestIndices[i]], outputArraysOfRequests[requestIndices[i]]);
+	}
+
 #ifdef MEASURE_TIME
 	stopCalculationMeasurement();
 #endif
@@ -516,6 +767,11 @@ PYBIND11_MODULE(openCOSMORS, m) {
 		This needs to be called before calling loadCalculations.
     )pbdoc");
 
+	m.def("createMoleculeLibrary", &createMoleculeLibraryOnPython, py::arg("options"), py::arg("libraryPath"), py::arg("componentPaths"), R"pbdoc(
+        Writes the molecules of the COSMOfiles into one molecule library file.
+		The molecules can then be loaded by their names setting the option sw_SR_moleculeLibraryPath.
+    )pbdoc");
+
 	m.def("loadCalculations", &loadCalculationsOnPython, py::arg("calculationsOnPython"), py::arg("reload") = false, R"pbdoc(
         Loads all calculations.
 		This needs to be called before calling calculate.
@@ -8,7 +8,7 @@
 #include "types.hpp"
 
 // this code is not optimized for fast calculation yet
-void calculateContactStatistics(calculation& _calculation, Eigen::MatrixXf& A_int_float, std::vector<Eigen::MatrixXd>& partialInteractionMatrices, Eigen::MatrixXf& Tau_float, float* Gamma, int i_concentration, Eigen::Tensor<float, 4, Eigen::RowMajor>& temporary_averageInteractionEnergies, Eigen::Tensor<float, 3, Eigen::RowMajor>& temporary_partialMolarEnergies, parameters& param) {
+void calculateContactStatistics(calculation& _calculation, Eigen::MatrixXf& A_int_float, std::vector<Eigen::MatrixXd>& partialInteractionMatrices, Eigen::MatrixXf& Tau_float, float* Gamma, int i_concentration, Eigen::Tensor<float, 3, Eigen::RowMajor>& temporary_contactStatistics, Eigen::Tensor<float, 4, Eigen::RowMajor>& temporary_averageInteractionEnergies, Eigen::Tensor<float, 3, Eigen::RowMajor>& temporary_partialMolarEnergies, parameters& param) {
 
 	/* Calculate contact statistics for all compositions.*/
 	const size_t numberOfComponents = _calculation.components.size();
@@ -25,13 +25,7 @@ void calculateContactStatistics(calculation& _calculation, Eigen::MatrixXf& A_in
 
 	double div_Aeff = 1 / param.Aeff;
 
-	Eigen::MatrixXd N_i_I(numberOfComponents, numberOfSegments); // number of segments of type I on molecule i
-
-	for (int j = 0; j < numberOfComponents; j++) {
-		for (int k = 0; k < numberOfSegments; k++) {
-			N_i_I(j, k) = _calculation.segments.SegmentTypeAreas[k][j] * div_Aeff;
-		}
-	}
+	Eigen::MatrixXd N_i_I = _calculation.segments.SegmentTypeAreas.topRows(numberOfSegments).transpose() * div_Aeff; // number of segments of type I on molecule i
 
 	Eigen::VectorXd N_mol = N_i_I.rowwise().sum();
 	double sum_xN = (N_mol.array() * x_vector.array()).sum(); // total number of segments per total number of molecules in mixture
@@ -51,10 +45,7 @@ void calculateContactStatistics(calculation& _calculation, Eigen::MatrixXf& A_in
 			Eigen::ArrayXXd temp = (gamma_vector.array() * N_i_I(mol_i, Eigen::indexing::all).transpose().array()).matrix() * (gamma_vector.array() * N_i_I(mol_j, Eigen::indexing::all).transpose().array()).matrix().transpose();
 			Eigen::ArrayXXd weighting = temp * Tau;
 
-			// contact statistics are directly written to the output
-			if (i_concentration < _calculation.originalNumberOfCalculations) {
-				_calculation.contactStatistics(i_concentration, mol_i, mol_j) = float(weighting.sum() * factor / N_mol(mol_i));
-			}
+			temporary_contactStatistics(i_concentration, mol_i, mol_j) = float(weighting.sum() * factor / N_mol(mol_i));
 			temporary_averageInteractionEnergies(i_concentration, 0, mol_i, mol_j) = float(N_AVOGADRO * 0.5 * factor * (weighting * A_int.array()).sum());
 
 			for (int k = 0; k < param.numberOfPartialInteractionMatrices; k++) {
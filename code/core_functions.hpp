@@ -9,8 +9,16 @@
 #include "interaction_matrix.hpp"
 #include "contact_statistics.hpp"
 #include "COSMOfile_functions.hpp"
+#include "molecule_cache.hpp"
+#include "molecule_library.hpp"
+#include "sigma_profile_file.hpp"
 #include <stdexcept>
 #include <functional>
+#include <unordered_set>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 
 #if defined(MEASURE_TIME) 
@@ -129,16 +137,159 @@ void initialize(parameters& param, bool initializeParameters = true, bool initia
         }
     }
 
-    if (initializeMolecules)
+    if (initializeMolecules) {
         molecules.clear();
+        moleculeComponentPaths.clear();
+        moleculesForContent.clear();
+        segmentProfiles.clear();
+    }
 
-    if (initializeCalculations)
+    if (initializeCalculations) {
         calculations.clear();
+        calculationRequests.clear();
+    }
 
     if (showBinarySpecs)
         display("\nBINARY SPECS\n-------------------------\n" + compilation_mode + "\n" + OPENMP_parallelization + "\n" + vectorization_level + "\n-------------------------\n\n");
 }
 
+// the segments of molecules with more segments than this are averaged on all threads. The loops running in parallel
+// over molecules therefore leave these molecules to be averaged one after another once their parallel region is over.
+const int minimumNumberOfSegmentsForParallelAveraging = 1000;
+
+bool isAveragedOnAllThreads(const molecule& _molecule) {
+    return _molecule.segmentAreas.size() > minimumNumberOfSegmentsForParallelAveraging;
+}
+
+// sorts the segments of a molecule into cubic cells of the given length ("0" puts all segments into one cell)
+// and optionally keeps the squared distances to the segments of the neighboring cells for later averagings,
+// in which case the positions are not needed anymore and released
+void buildSigmaAveragingGeometry(molecule& _molecule, double cellLength, bool keepSquaredDistances, bool useSinglePrecision = false) {
+
+    sigmaAveragingGeometry& geometry = _molecule.averagingGeometry;
+    geometry.clear();
+
+    int numberOfSegments = int(_molecule.segmentAreas.size());
+
+    geometry.cellLength = cellLength;
+    geometry.lowerCorner = Eigen::Vector3d::Zero();
+    geometry.numberOfCells = Eigen::Vector3i::Ones();
+    if (cellLength > 0) {
+        geometry.lowerCorner = _molecule.segmentPositions.colwise().minCoeff().transpose();
+        Eigen::Vector3d extent = _molecule.segmentPositions.colwise().maxCoeff().transpose() - geometry.lowerCorner;
+        for (int d = 0; d < 3; d++) {
+            geometry.numberOfCells(d) = int(extent(d) / cellLength) + 1;
+        }
+    }
+
+    // sort the segments into the cells keeping the original order within a cell
+    geometry.firstSegmentOfCell.assign(geometry.numberOfCells.prod() + 1, 0);
+    geometry.cellOfSegment.resize(numberOfSegments);
+    for (int i = 0; i < numberOfSegments; i++) {
+        Eigen::Vector3i cellCoordinates = Eigen::Vector3i::Zero();
+        if (cellLength > 0) {
+            for (int d = 0; d < 3; d++) {
+                cellCoordinates(d) = std::min(int((_molecule.segmentPositions(i, d) - geometry.lowerCorner(d)) / cellLength), geometry.numberOfCells(d) - 1);
+            }
+        }
+        geometry.cellOfSegment[i] = (cellCoordinates(2) * geometry.numberOfCells(1) + cellCoordinates(1)) * geometry.numberOfCells(0) + cellCoordinates(0);
+        geometry.firstSegmentOfCell[geometry.cellOfSegment[i] + 1]++;
+    }
+    for (int c = 1; c < geometry.firstSegmentOfCell.size(); c++) {
+        geometry.maximumNumberOfSegmentsInCell = std::max(geometry.maximumNumberOfSegmentsInCell, geometry.firstSegmentOfCell[c]);
+    }
+    std::partial_sum(geometry.firstSegmentOfCell.begin(), geometry.firstSegmentOfCell.end(), geometry.firstSegmentOfCell.begin());
+
+    geometry.segmentsInCells.resize(numberOfSegments);
+    {
+        std::vector<int> insertPosition(geometry.firstSegmentOfCell.begin(), geometry.firstSegmentOfCell.end() - 1);
+        for (int i = 0; i < numberOfSegments; i++) {
+            geometry.segmentsInCells[insertPosition[geometry.cellOfSegment[i]]++] = i;
+        }
+    }
+
+    geometry.cellOrderedPositionsX.resize(numberOfSegments);
+    geometry.cellOrderedPositionsY.resize(numberOfSegments);
+    geometry.cellOrderedPositionsZ.resize(numberOfSegments);
+    geometry.cellOrderedSigmas.resize(numberOfSegments);
+    geometry.cellOrderedRadiiSquared.resize(numberOfSegments);
+
+    for (int h = 0; h < numberOfSegments; h++) {
+        int segmentIndex = geometry.segmentsInCells[h];
+        geometry.cellOrderedPositionsX(h) = _molecule.segmentPositions(segmentIndex, 0);
+        geometry.cellOrderedPositionsY(h) = _molecule.segmentPositions(segmentIndex, 1);
+        geometry.cellOrderedPositionsZ(h) = _molecule.segmentPositions(segmentIndex, 2);
+        geometry.cellOrderedSigmas(h) = _molecule.segmentSigmas(segmentIndex);
+        geometry.cellOrderedRadiiSquared(h) = _molecule.segmentAreas(segmentIndex) / PI;
+    }
+
+    if (keepSquaredDistances == false)
+        return;
+
+    geometry.firstNeighborOfSegment.assign(numberOfSegments + 1, 0);
+    for (int i = 0; i < numberOfSegments; i++) {
+        size_t numberOfNeighbors = 0;
+        geometry.forEachNeighborCell(i, [&](int, int numberOfSegmentsInCell) {
+            numberOfNeighbors += numberOfSegmentsInCell;
+        });
+        geometry.firstNeighborOfSegment[i + 1] = geometry.firstNeighborOfSegment[i] + numberOfNeighbors;
+    }
+
+    if (useSinglePrecision)
+        geometry.singlePrecisionNeighborSquaredDistances.resize(geometry.firstNeighborOfSegment[numberOfSegments]);
+    else
+        geometry.neighborSquaredDistances.resize(geometry.firstNeighborOfSegment[numberOfSegments]);
+
+#if defined(_OPENMP)
+#pragma omp parallel for if(numberOfSegments > minimumNumberOfSegmentsForParallelAveraging)
+#endif
+    for (int i = 0; i < numberOfSegments; i++) {
+        double positionX = _molecule.segmentPositions(i, 0);
+        double positionY = _molecule.segmentPositions(i, 1);
+        double positionZ = _molecule.segmentPositions(i, 2);
+
+        size_t neighborIndex = geometry.firstNeighborOfSegment[i];
+        geometry.forEachNeighborCell(i, [&](int first, int numberOfSegmentsInCell) {
+            auto squaredDistances = (geometry.cellOrderedPositionsX.segment(first, numberOfSegmentsInCell) - positionX).square()
+                + (geometry.cellOrderedPositionsY.segment(first, numberOfSegmentsInCell) - positionY).square()
+                + (geometry.cellOrderedPositionsZ.segment(first, numberOfSegmentsInCell) - positionZ).square();
+            if (useSinglePrecision)
+                geometry.singlePrecisionNeighborSquaredDistances.segment(neighborIndex, numberOfSegmentsInCell) = squaredDistances.cast<float>();
+            else
+                geometry.neighborSquaredDistances.segment(neighborIndex, numberOfSegmentsInCell) = squaredDistances;
+            neighborIndex += numberOfSegmentsInCell;
+        });
+    }
+
+    geometry.cellOrderedPositionsX.resize(0);
+    geometry.cellOrderedPositionsY.resize(0);
+    geometry.cellOrderedPositionsZ.resize(0);
+}
+
+// the coarse sigma grid has to end on the last value of the charge raster for all sigmas inside the raster to be clustered
+void checkSigmaGridCoarseningFactor(const parameters& param) {
+
+    int numberOfSigmaSteps = int(param.ChargeRaster.size()) - 1;
+    if (param.sw_sigmaGridCoarseningFactor < 1 || numberOfSigmaSteps % param.sw_sigmaGridCoarseningFactor != 0) {
+        throw std::runtime_error("sw_SR_sigmaGridCoarseningFactor has to be a positive divisor of the number of sigma steps " + std::to_string(numberOfSigmaSteps) + ".");
+    }
+}
+
+// the QSPR model of the molar volume used for solvation energies was parametrized on one quantum chemistry method
+void checkQuantumChemistryMethodForMolarVolume(parameters& param, molecule& _molecule) {
+
+    bool calculateSolvationEnergies = param.dGsolv_E_gas.size() > 0;
+    if (calculateSolvationEnergies && _molecule.qmMethod != "DFT_CPCM_BP86_def2-TZVP+def2-TZVPD_SP" && _molecule.qmMethod != "DFT_BP86_def2-TZVPD_SP"){
+        if (param.sw_dGsolv_calculation_strict == 1) {
+            throw std::runtime_error("The QSPR model for the molar volume only works for the quantum chemistry method DFT_BP86_def2-TZVPD_SP");
+        }
+        else {
+            std::lock_guard<std::mutex> guard(loadMoleculeLock);
+            warnings.push_back(" - The QSPR model for the molar volume was parametrized using a different quantum chemistry method than the one you are using. Recommended method: DFT_BP86_def2-TZVPD_SP");
+        }
+    }
+}
+
 void averageAndClusterSegments(parameters& param, molecule& _molecule, int approximateNumberOfSegmentTypes = 0) {
 
     // save reallocation time by specifying the approximate segment type number
@@ -174,46 +325,121 @@ void averageAndClusterSegments(parameters& param, molecule& _molecule, int appro
         averagedSigmaCorrs = Eigen::VectorXd::Zero(numberOfSegments);
     }
 
-    double distanceSegmentSegmentSquared;
-    double temporaryValue = 0, multiplyingFactor = 0;
+    // neighbor search on a grid of cubic cells, only segments in the same or in adjacent cells are averaged.
+    // The cell length is the distance beyond which both gaussian weights are smaller than the cutoff times their prefactor.
+    // Without a cutoff all segments are in one cell giving the exact sum.
+    double cellLength = 0;
+    if (param.sw_sigmaAveragingWeightCutoff > 0 && param.sw_sigmaAveragingWeightCutoff < 1 && numberOfSegments > 0) {
+        double maximumAveragingRadiusSquared = calculateMisfitCorrelation ? std::max(RavSquared, RavCorrSquared) : RavSquared;
+        cellLength = sqrt(-log(param.sw_sigmaAveragingWeightCutoff) * (segmentRadiiSquared.maxCoeff() + maximumAveragingRadiusSquared));
+    }
 
-    for (int segmentIndexI = 0; segmentIndexI < numberOfSegments; segmentIndexI++) {
+    // when reloading the sigma profiles the geometry of the previous call is reused if its cells are large enough.
+    // The squared distances are only kept with a cutoff, without one these would be the distances of all segment pairs
+    // and they are calculated again from the positions in every call.
+    bool reuseGeometry = param.sw_alwaysReloadSigmaProfiles == 1;
+    if (reuseGeometry == false || _molecule.averagingGeometry.isUsableFor(cellLength) == false) {
+        buildSigmaAveragingGeometry(_molecule, cellLength, reuseGeometry && cellLength > 0, param.sw_singlePrecisionSegmentDistances == 1);
+    }
+    const sigmaAveragingGeometry& geometry = _molecule.averagingGeometry;
+    bool useKeptSquaredDistances = geometry.firstNeighborOfSegment.size() > 0;
+    bool useSinglePrecisionSquaredDistances = geometry.singlePrecisionNeighborSquaredDistances.size() > 0;
+
+    // the weights for Rav and RavCorr are stored in adjacent columns and calculated with one vectorized exp
+    int numberOfWeights = calculateMisfitCorrelation ? 2 : 1;
+    Eigen::VectorXd averagingRadiiSquared(numberOfWeights);
+    averagingRadiiSquared(0) = RavSquared;
+    if (calculateMisfitCorrelation == true)
+        averagingRadiiSquared(1) = RavCorrSquared;
+
+    Eigen::ArrayXXd cellOrderedWeightPrefactors(numberOfSegments, numberOfWeights);
+    Eigen::ArrayXXd cellOrderedNegativeInverseWidths(numberOfSegments, numberOfWeights);
+
+    for (int k = 0; k < numberOfWeights; k++) {
+        Eigen::ArrayXd widths = geometry.cellOrderedRadiiSquared + averagingRadiiSquared(k);
+        cellOrderedWeightPrefactors.col(k) = geometry.cellOrderedRadiiSquared * averagingRadiiSquared(k) / widths;
+        cellOrderedNegativeInverseWidths.col(k) = -1.0 / widths;
+    }
 
-        double runningTotalSigmas = 0, runningTotalSigmaCorrs = 0;
+    // the sums of the prefactors are used to bound the contribution of the neglected segments
+    int numberOfCellsTotal = int(geometry.firstSegmentOfCell.size()) - 1;
+    Eigen::ArrayXXd cellWeightPrefactorSums(numberOfCellsTotal, numberOfWeights);
+    for (int c = 0; c < numberOfCellsTotal; c++) {
+        cellWeightPrefactorSums.row(c) = cellOrderedWeightPrefactors.middleRows(geometry.firstSegmentOfCell[c], geometry.firstSegmentOfCell[c + 1] - geometry.firstSegmentOfCell[c]).colwise().sum();
+    }
+    Eigen::ArrayXd sumOfWeightPrefactors = cellOrderedWeightPrefactors.colwise().sum().transpose();
+    double sigmaRange = numberOfSegments > 0 ? _molecule.segmentSigmas.maxCoeff() - _molecule.segmentSigmas.minCoeff() : 0;
 
-        for (int segmentIndexJ = 0; segmentIndexJ < numberOfSegments; segmentIndexJ++) {
-            distanceSegmentSegmentSquared = (_molecule.segmentPositions(segmentIndexI, Eigen::indexing::all) - _molecule.segmentPositions(segmentIndexJ, Eigen::indexing::all)).array().square().matrix().sum();
+    Eigen::VectorXd maximumDeviations = Eigen::VectorXd::Zero(numberOfSegments);
 
-            temporaryValue = segmentRadiiSquared(segmentIndexJ) + RavSquared;
-            multiplyingFactor = ((segmentRadiiSquared(segmentIndexJ) * RavSquared) / temporaryValue) * exp(-distanceSegmentSegmentSquared / temporaryValue);
+#if defined(_OPENMP)
+#pragma omp parallel if(numberOfSegments > minimumNumberOfSegmentsForParallelAveraging)
+#endif
+    {
+        // buffers of every thread
+        Eigen::ArrayXd distancesSquared(geometry.maximumNumberOfSegmentsInCell);
+        Eigen::ArrayXXd weights(geometry.maximumNumberOfSegmentsInCell, numberOfWeights);
+        Eigen::ArrayXd runningTotals(numberOfWeights), weightedSigmaSums(numberOfWeights), includedWeightPrefactors(numberOfWeights);
 
-            runningTotalSigmas += multiplyingFactor;
-            averagedSigmas(segmentIndexI) = averagedSigmas(segmentIndexI) + _molecule.segmentSigmas(segmentIndexJ) * multiplyingFactor;
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+        for (int segmentIndexI = 0; segmentIndexI < numberOfSegments; segmentIndexI++) {
 
-            if (calculateMisfitCorrelation == true) {
-                temporaryValue = segmentRadiiSquared(segmentIndexJ) + RavCorrSquared;
-                multiplyingFactor = ((segmentRadiiSquared(segmentIndexJ) * RavCorrSquared) / temporaryValue) * exp(-distanceSegmentSegmentSquared / temporaryValue);
+            runningTotals.setZero();
+            weightedSigmaSums.setZero();
+            includedWeightPrefactors.setZero();
+
+            double positionX = _molecule.segmentPositions(segmentIndexI, 0);
+            double positionY = _molecule.segmentPositions(segmentIndexI, 1);
+            double positionZ = _molecule.segmentPositions(segmentIndexI, 2);
+
+            size_t neighborIndex = useKeptSquaredDistances ? geometry.firstNeighborOfSegment[segmentIndexI] : 0;
+
+            geometry.forEachNeighborCell(segmentIndexI, [&](int first, int numberOfSegmentsInCell) {
+
+                if (useKeptSquaredDistances) {
+                    if (useSinglePrecisionSquaredDistances)
+                        distancesSquared.head(numberOfSegmentsInCell) = geometry.singlePrecisionNeighborSquaredDistances.segment(neighborIndex, numberOfSegmentsInCell).cast<double>();
+                    else
+                        distancesSquared.head(numberOfSegmentsInCell) = geometry.neighborSquaredDistances.segment(neighborIndex, numberOfSegmentsInCell);
+                    neighborIndex += numberOfSegmentsInCell;
+                }
+                else {
+                    distancesSquared.head(numberOfSegmentsInCell) = (geometry.cellOrderedPositionsX.segment(first, numberOfSegmentsInCell) - positionX).square()
+                        + (geometry.cellOrderedPositionsY.segment(first, numberOfSegmentsInCell) - positionY).square()
+                        + (geometry.cellOrderedPositionsZ.segment(first, numberOfSegmentsInCell) - positionZ).square();
+                }
+
+                weights.topRows(numberOfSegmentsInCell) = cellOrderedWeightPrefactors.middleRows(first, numberOfSegmentsInCell)
+                    * (cellOrderedNegativeInverseWidths.middleRows(first, numberOfSegmentsInCell) * distancesSquared.head(numberOfSegmentsInCell).replicate(1, numberOfWeights)).exp();
+
+                for (int k = 0; k < numberOfWeights; k++) {
+                    runningTotals(k) += weights.col(k).head(numberOfSegmentsInCell).sum();
+                    weightedSigmaSums(k) += (weights.col(k).head(numberOfSegmentsInCell) * geometry.cellOrderedSigmas.segment(first, numberOfSegmentsInCell)).sum();
+                }
+                includedWeightPrefactors += cellWeightPrefactorSums.row(geometry.cellOfSegment[geometry.segmentsInCells[first]]).transpose();
+            });
+
+            averagedSigmas(segmentIndexI) = weightedSigmaSums(0) / runningTotals(0);
+
+            if (calculateMisfitCorrelation == true)
+                averagedSigmaCorrs(segmentIndexI) = weightedSigmaSums(1) / runningTotals(1);
 
-                runningTotalSigmaCorrs += multiplyingFactor;
-                averagedSigmaCorrs(segmentIndexI) = averagedSigmaCorrs(segmentIndexI) + _molecule.segmentSigmas(segmentIndexJ) * multiplyingFactor;
+            // every neglected weight is smaller than the cutoff times its prefactor, a neglected total weight w moves
+            // the average by at most w / (runningTotal + w) times the sigma range which stays below the sigma range
+            if (geometry.cellLength > 0) {
+                Eigen::ArrayXd neglectedWeightBounds = param.sw_sigmaAveragingWeightCutoff * (sumOfWeightPrefactors - includedWeightPrefactors).max(0.0);
+                maximumDeviations(segmentIndexI) = (neglectedWeightBounds / (runningTotals + neglectedWeightBounds) * sigmaRange).maxCoeff();
             }
         }
-        averagedSigmas(segmentIndexI) = averagedSigmas(segmentIndexI) / runningTotalSigmas;
-
-        if (calculateMisfitCorrelation == true)
-            averagedSigmaCorrs(segmentIndexI) = averagedSigmaCorrs(segmentIndexI) / runningTotalSigmaCorrs;
     }
 
+    _molecule.maximumSigmaAveragingDeviation = numberOfSegments > 0 ? maximumDeviations.maxCoeff() : 0;
+
     bool calculateSolvationEnergies = param.dGsolv_E_gas.size() > 0;
-    if (calculateSolvationEnergies){
-        if (_molecule.qmMethod != "DFT_CPCM_BP86_def2-TZVP+def2-TZVPD_SP" && _molecule.qmMethod != "DFT_BP86_def2-TZVPD_SP"){
-            if (param.sw_dGsolv_calculation_strict == 1) {
-                throw std::runtime_error("The QSPR model for the molar volume only works for the quantum chemistry method DFT_BP86_def2-TZVPD_SP");
-            }
-            else {
-                warnings.push_back(" - The QSPR model for the molar volume was parametrized using a different quantum chemistry method than the one you are using. Recommended method: DFT_BP86_def2-TZVPD_SP");
-            }
-        }
+    if (calculateSolvationEnergies || param.sw_estimateMolarVolume == 1){
+        checkQuantumChemistryMethodForMolarVolume(param, _molecule);
 
         int numberOfSiAtoms = 0;
         int numberOfHAtoms = 0;
@@ -267,82 +493,188 @@ void averageAndClusterSegments(parameters& param, molecule& _molecule, int appro
         }
     }
 
-    // cluster segments into segment types
-    float sigmaLeft = -1;
-    float sigmaRight = -1;
-    double AsigmaLeft = -1;
-    double AsigmaRight = -1;
+    // cluster segments into segment types on a sigma grid with the given coarsening factor of param.sigmaStep
+    // returns the increase of the second sigma moment caused by distributing the areas onto the grid
+    auto clusterSegments = [&](segmentTypeCollection& segments, int coarseningFactor) {
 
-    float sigmaCorrLeft = -1;
-    float sigmaCorrRight = -1;
+        const double clusterStep = param.sigmaStep * coarseningFactor;
+        double secondSigmaMomentIncrease = 0;
 
-    double AsigmaLeftSigmaCorrLeft = -1;
-    double AsigmaLeftSigmaCorrRight = -1;
-    double AsigmaRightSigmaCorrLeft = -1;
-    double AsigmaRightSigmaCorrRight = -1;
+        float sigmaLeft = -1;
+        float sigmaRight = -1;
+        double AsigmaLeft = -1;
+        double AsigmaRight = -1;
 
-    unsigned short ind_SigmaCorr_left = 0;
+        float sigmaCorrLeft = -1;
+        float sigmaCorrRight = -1;
 
-    for (int j = 0; j < numberOfSegments; j++) {
+        double AsigmaLeftSigmaCorrLeft = -1;
+        double AsigmaLeftSigmaCorrRight = -1;
+        double AsigmaRightSigmaCorrLeft = -1;
+        double AsigmaRightSigmaCorrRight = -1;
 
-        unsigned short ind_Sigma_left = int((averagedSigmas(j) - param.sigmaMin) / param.sigmaStep);
+        unsigned short ind_SigmaCorr_left = 0;
 
-        sigmaLeft = (float)param.ChargeRaster[ind_Sigma_left];
-        sigmaRight = (float)param.ChargeRaster[ind_Sigma_left + 1];
+        for (int j = 0; j < numberOfSegments; j++) {
 
-        AsigmaRight = _molecule.segmentAreas(j) * (averagedSigmas(j) - sigmaLeft) / param.sigmaStep;
-        AsigmaLeft = _molecule.segmentAreas(j) * (sigmaRight - averagedSigmas(j)) / param.sigmaStep;
+            unsigned short ind_Sigma_left = int((averagedSigmas(j) - param.sigmaMin) / clusterStep) * coarseningFactor;
 
+            if (ind_Sigma_left + coarseningFactor >= param.ChargeRaster.size()) {
+                throw std::runtime_error("The sigma of a segment of molecule " + _molecule.name + " lies outside of the sigma grid.");
+            }
 
-        if (calculateMisfitCorrelation == true) {
-            ind_SigmaCorr_left = int((averagedSigmaCorrs(j) - param.sigmaMin) / param.sigmaStep);
+            sigmaLeft = (float)param.ChargeRaster[ind_Sigma_left];
+            sigmaRight = (float)param.ChargeRaster[ind_Sigma_left + coarseningFactor];
 
-            sigmaCorrLeft = (float)param.ChargeRaster[ind_SigmaCorr_left];
-            sigmaCorrRight = (float)param.ChargeRaster[ind_SigmaCorr_left + 1];
+            AsigmaRight = _molecule.segmentAreas(j) * (averagedSigmas(j) - sigmaLeft) / clusterStep;
+            AsigmaLeft = _molecule.segmentAreas(j) * (sigmaRight - averagedSigmas(j)) / clusterStep;
 
-            AsigmaLeftSigmaCorrRight = AsigmaLeft * (averagedSigmaCorrs(j) - sigmaCorrLeft) / param.sigmaStep;
-            AsigmaLeftSigmaCorrLeft = AsigmaLeft * (sigmaCorrRight - averagedSigmaCorrs(j)) / param.sigmaStep;
-            AsigmaRightSigmaCorrRight = AsigmaRight * (averagedSigmaCorrs(j) - sigmaCorrLeft) / param.sigmaStep;
-            AsigmaRightSigmaCorrLeft = AsigmaRight * (sigmaCorrRight - averagedSigmaCorrs(j)) / param.sigmaStep;
-        }
+            secondSigmaMomentIncrease += _molecule.segmentAreas(j) * (averagedSigmas(j) - sigmaLeft) * (sigmaRight - averagedSigmas(j));
+
+            if (calculateMisfitCorrelation == true) {
+                ind_SigmaCorr_left = int((averagedSigmaCorrs(j) - param.sigmaMin) / clusterStep) * coarseningFactor;
 
+                if (ind_SigmaCorr_left + coarseningFactor >= param.ChargeRaster.size()) {
+                    throw std::runtime_error("The sigmaCorr of a segment of molecule " + _molecule.name + " lies outside of the sigma grid.");
+                }
+
+                sigmaCorrLeft = (float)param.ChargeRaster[ind_SigmaCorr_left];
+                sigmaCorrRight = (float)param.ChargeRaster[ind_SigmaCorr_left + coarseningFactor];
 
-        unsigned short atomicNumber = _molecule.segmentAtomicNumber(j);
-        if (param.sw_atomicNumber == 0) {
-            atomicNumber = 0;
+                AsigmaLeftSigmaCorrRight = AsigmaLeft * (averagedSigmaCorrs(j) - sigmaCorrLeft) / clusterStep;
+                AsigmaLeftSigmaCorrLeft = AsigmaLeft * (sigmaCorrRight - averagedSigmaCorrs(j)) / clusterStep;
+                AsigmaRightSigmaCorrRight = AsigmaRight * (averagedSigmaCorrs(j) - sigmaCorrLeft) / clusterStep;
+                AsigmaRightSigmaCorrLeft = AsigmaRight * (sigmaCorrRight - averagedSigmaCorrs(j)) / clusterStep;
+            }
+
+
+            unsigned short atomicNumber = _molecule.segmentAtomicNumber(j);
+            if (param.sw_atomicNumber == 0) {
+                atomicNumber = 0;
+            }
+
+            // for monoatomic ions or if misfit correlation is deactivated
+            if (_molecule.moleculeGroup == 3 || _molecule.moleculeGroup == 5 || calculateMisfitCorrelation == false) {
+
+                segments.add(0, _molecule.moleculeGroup, sigmaLeft, 0.0f, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaLeft);
+                segments.add(0, _molecule.moleculeGroup, sigmaRight, 0.0f, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaRight);
+            }
+            else {
+                segments.add(0, _molecule.moleculeGroup, sigmaLeft, sigmaCorrLeft, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaLeftSigmaCorrLeft);
+                segments.add(0, _molecule.moleculeGroup, sigmaLeft, sigmaCorrRight, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaLeftSigmaCorrRight);
+                segments.add(0, _molecule.moleculeGroup, sigmaRight, sigmaCorrLeft, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaRightSigmaCorrLeft);
+                segments.add(0, _molecule.moleculeGroup, sigmaRight, sigmaCorrRight, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaRightSigmaCorrRight);
+            }
         }
 
-        // for monoatomic ions or if misfit correlation is deactivated
-        if (_molecule.moleculeGroup == 3 || _molecule.moleculeGroup == 5 || calculateMisfitCorrelation == false) {
+        return secondSigmaMomentIncrease;
+    };
+
+    const int coarseningFactor = param.sw_sigmaGridCoarseningFactor;
+    double secondSigmaMomentIncrease = clusterSegments(_molecule.segments, coarseningFactor);
+
+    // the segment types are kept in the canonical order so that calculations can be built by merging them
+    _molecule.segments.sort();
+
+    // for the coarsened grid the full grid is clustered as well to report the reduction of segment types
+    // the error is estimated as the increase of the second sigma moment relative to the one on the full grid
+    if (coarseningFactor > 1) {
+        segmentTypeCollection segmentsOnFullGrid(1);
+        double secondSigmaMomentIncreaseOnFullGrid = clusterSegments(segmentsOnFullGrid, 1);
+        double secondSigmaMomentOnFullGrid = (averagedSigmas.array().square() * _molecule.segmentAreas.array()).sum() + secondSigmaMomentIncreaseOnFullGrid;
+
+        _molecule.numberOfSegmentTypesOnFullSigmaGrid = int(segmentsOnFullGrid.size());
+        _molecule.relativeSecondSigmaMomentDeviation = secondSigmaMomentOnFullGrid > 0 ? (secondSigmaMomentIncrease - secondSigmaMomentIncreaseOnFullGrid) / secondSigmaMomentOnFullGrid : 0;
+    }
+}
+
+// displays the effect of the approximations used to calculate the sigma profiles if any is activated
+void reportSigmaProfileApproximations(parameters& param) {
+
+    if (param.sw_sigmaAveragingWeightCutoff > 0) {
 
-            _molecule.segments.add(0, _molecule.moleculeGroup, sigmaLeft, 0.0f, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaLeft);
-            _molecule.segments.add(0, _molecule.moleculeGroup, sigmaRight, 0.0f, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaRight);
+        double maximumDeviation = 0;
+        std::string nameOfMaximumDeviation = "";
+
+        for (int i = 0; i < molecules.size(); i++) {
+            if (molecules[i] != nullptr && molecules[i]->maximumSigmaAveragingDeviation >= maximumDeviation) {
+                maximumDeviation = molecules[i]->maximumSigmaAveragingDeviation;
+                nameOfMaximumDeviation = molecules[i]->name;
+            }
         }
-        else {
-            _molecule.segments.add(0, _molecule.moleculeGroup, sigmaLeft, sigmaCorrLeft, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaLeftSigmaCorrLeft);
-            _molecule.segments.add(0, _molecule.moleculeGroup, sigmaLeft, sigmaCorrRight, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaLeftSigmaCorrRight);
-            _molecule.segments.add(0, _molecule.moleculeGroup, sigmaRight, sigmaCorrLeft, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaRightSigmaCorrLeft);
-            _molecule.segments.add(0, _molecule.moleculeGroup, sigmaRight, sigmaCorrRight, _molecule.segmentHydrogenBondingType(j), atomicNumber, AsigmaRightSigmaCorrRight);
+
+        display("\nSIGMA AVERAGING CUTOFF\n-------------------------\n");
+        std::ostringstream oss;
+        oss << "weight cutoff: " << param.sw_sigmaAveragingWeightCutoff << "\n";
+        oss << "upper bound of the deviation of an averaged sigma from the exact sum: " << maximumDeviation << " e/A^2 (" << nameOfMaximumDeviation << ")\n";
+        display(oss.str());
+        display("-------------------------\n\n");
+    }
+
+    if (param.sw_sigmaGridCoarseningFactor > 1) {
+
+        size_t numberOfSegmentTypesOnFullGrid = 0;
+        size_t numberOfSegmentTypes = 0;
+        double maximumRelativeDeviation = 0;
+        std::string nameOfMaximumRelativeDeviation = "";
+
+        for (int i = 0; i < molecules.size(); i++) {
+            if (molecules[i] == nullptr)
+                continue;
+
+            numberOfSegmentTypesOnFullGrid += molecules[i]->numberOfSegmentTypesOnFullSigmaGrid;
+            numberOfSegmentTypes += molecules[i]->profile.size();
+
+            if (molecules[i]->relativeSecondSigmaMomentDeviation >= maximumRelativeDeviation) {
+                maximumRelativeDeviation = molecules[i]->relativeSecondSigmaMomentDeviation;
+                nameOfMaximumRelativeDeviation = molecules[i]->name;
+            }
         }
+
+        display("\nSIGMA GRID COARSENING\n-------------------------\n");
+        display("sigma step: " + std::to_string(param.sigmaStep * param.sw_sigmaGridCoarseningFactor) + " instead of " + std::to_string(param.sigmaStep) + "\n");
+        display("segment types of all molecules: " + std::to_string(numberOfSegmentTypes) + " instead of " + std::to_string(numberOfSegmentTypesOnFullGrid) + "\n");
+        display("maximum relative deviation of the second sigma moment: " + std::to_string(100 * maximumRelativeDeviation) + " % (" + nameOfMaximumRelativeDeviation + ")\n");
+        display("-------------------------\n\n");
     }
 }
 
-molecule loadNewMolecule(parameters& param, std::string componentPath) {
+// the file name without directory and extensions
+std::string getMoleculeNameFromPath(std::string componentPath) {
+
+    std::vector<std::string> parts = split(componentPath, '\\');
+    parts = split(parts[parts.size() - 1], '/');
+    parts = split(parts[parts.size() - 1], '.');
+    return trim(parts[0]);
+}
+
+// reads the molecule from the COSMOfile or from the molecule cache, the name is derived from the file name
+molecule readMoleculeFromCOSMOfile(parameters& param, std::string componentPath) {
 
     molecule newMolecule;
-    if (param.sw_COSMOfiles_type == "Turbomole_COSMO_TZVP" || param.sw_COSMOfiles_type == "Turbomole_COSMO_TZVPD_FINE") {
-        newMolecule = getMoleculeFromTurbomoleCOSMOfile(componentPath);
-    } else if (param.sw_COSMOfiles_type == "ORCA_COSMO_TZVPD") {
-        newMolecule = getMoleculeFromORCACOSMOfile(componentPath);
-    } else {
-        throw std::runtime_error("No method for reading COSMOfiles has been implemented for the following type: " + param.sw_COSMOfiles_type);
+    bool useMoleculeCache = param.sw_moleculeCacheDirectory != "";
+
+    if (useMoleculeCache == false || readMoleculeFromCache(param, componentPath, newMolecule) == false) {
+        if (param.sw_COSMOfiles_type == "Turbomole_COSMO_TZVP" || param.sw_COSMOfiles_type == "Turbomole_COSMO_TZVPD_FINE") {
+            newMolecule = getMoleculeFromTurbomoleCOSMOfile(componentPath);
+        } else if (param.sw_COSMOfiles_type == "ORCA_COSMO_TZVPD") {
+            newMolecule = getMoleculeFromORCACOSMOfile(componentPath);
+        } else {
+            throw std::runtime_error("No method for reading COSMOfiles has been implemented for the following type: " + param.sw_COSMOfiles_type);
+        }
+
+        if (useMoleculeCache) {
+            writeMoleculeToCache(param, componentPath, newMolecule);
+        }
     }
 
-    std::string componentName = componentPath;
-    std::vector<std::string> parts = split(componentName, '\\');
-    parts = split(parts[parts.size() - 1], '/');
-    parts = split(parts[parts.size() - 1], '.');
-    newMolecule.name = trim(parts[0]);
+    newMolecule.name = getMoleculeNameFromPath(componentPath);
+
+    return newMolecule;
+}
+
+// prepares a molecule read from a COSMOfile or a molecule library for the calculations
+void finishLoadingNewMolecule(parameters& param, molecule& newMolecule) {
 
     int numberOfAtoms = int(newMolecule.atomAtomicNumbers.size());
 
@@ -350,14 +682,17 @@ molecule loadNewMolecule(parameters& param, std::string componentPath) {
 
     newMolecule.moleculeCharge = (signed char)(std::round(-1.0f * sumOfScreeningCharge));
 
-    // Store atomic radii and check for consistency
-    for (int atomIndex = 0; atomIndex < numberOfAtoms; atomIndex++) {
-        int AtomicNumber = newMolecule.atomAtomicNumbers(atomIndex);
-        if (param.R_i_COSMO[AtomicNumber] != 0 && newMolecule.atomRadii(atomIndex) != param.R_i_COSMO[AtomicNumber]) {
-            throw std::runtime_error("Inconsistent radii set for atomic number " + std::to_string(AtomicNumber) + " was found.");
-        }
-        else if (param.R_i_COSMO[AtomicNumber] == 0 && newMolecule.atomRadii(atomIndex) != 0) {
-            param.R_i_COSMO[AtomicNumber] = newMolecule.atomRadii(atomIndex);
+    // Store atomic radii and check for consistency, the radii are shared by all molecules loaded in parallel
+    {
+        std::lock_guard<std::mutex> guard(loadMoleculeLock);
+        for (int atomIndex = 0; atomIndex < numberOfAtoms; atomIndex++) {
+            int AtomicNumber = newMolecule.atomAtomicNumbers(atomIndex);
+            if (param.R_i_COSMO[AtomicNumber] != 0 && newMolecule.atomRadii(atomIndex) != param.R_i_COSMO[AtomicNumber]) {
+                throw std::runtime_error("Inconsistent radii set for atomic number " + std::to_string(AtomicNumber) + " was found.");
+            }
+            else if (param.R_i_COSMO[AtomicNumber] == 0 && newMolecule.atomRadii(atomIndex) != 0) {
+                param.R_i_COSMO[AtomicNumber] = newMolecule.atomRadii(atomIndex);
+            }
         }
     }
 
@@ -435,6 +770,8 @@ molecule loadNewMolecule(parameters& param, std::string componentPath) {
                 }
             }
             newMolecule.atomAtomicNumbers(atomIndexI) = 100 + newMolecule.atomAtomicNumbers(closestAtomIndex);
+
+            std::lock_guard<std::mutex> guard(loadMoleculeLock);
             param.R_i_COSMO[100 + newMolecule.atomAtomicNumbers(closestAtomIndex)] = param.R_i_COSMO[1];
         }
     }
@@ -452,33 +789,408 @@ molecule loadNewMolecule(parameters& param, std::string componentPath) {
     }
 
     newMolecule.segmentHydrogenBondingType = Eigen::VectorXi(numberOfSegments);
-    averageAndClusterSegments(param, newMolecule);
+
+    // the cache also holds the estimated molar volume
+    bool useSegmentProfileCache = param.sw_moleculeCacheDirectory != "";
+    if (useSegmentProfileCache == false || readSegmentProfileFromCache(param, newMolecule) == false) {
+        averageAndClusterSegments(param, newMolecule);
+
+        if (useSegmentProfileCache) {
+            writeSegmentProfileToCache(param, newMolecule);
+        }
+    }
+    else if (param.dGsolv_E_gas.size() > 0 || param.sw_estimateMolarVolume == 1) {
+        checkQuantumChemistryMethodForMolarVolume(param, newMolecule);
+    }
 
     newMolecule.clear_unneeded_matrices(param.sw_alwaysReloadSigmaProfiles);
-    newMolecule.segments.shrink_to_fit();
+    newMolecule.finishSegmentProfile(segmentProfiles);
+}
+
+// writes the extended sigma profile of a finished molecule if requested, the file is named after the molecule
+void writeExtendedSigmaProfileOfNewMolecule(parameters& param, molecule& newMolecule) {
 
 #ifdef DEBUG_INFO
-    newMolecule.segments.sort();
-    WriteExtendedSigmaProfiletoFile(newMolecule.name + ".extsp", newMolecule.segments);
+    WriteExtendedSigmaProfiletoFile(newMolecule.name + ".extsp", newMolecule, getSegmentProfileSettingsHash(param));
 #endif
 
+    if (param.sw_extendedSigmaProfileDirectory != "") {
+        std::string directory = param.sw_extendedSigmaProfileDirectory;
+        if (directory.back() != '/' && directory.back() != '\\')
+            directory += "/";
+        WriteExtendedSigmaProfiletoFile(directory + newMolecule.name + ".extsp", newMolecule, getSegmentProfileSettingsHash(param));
+    }
+}
+
+molecule loadNewMolecule(parameters& param, std::string componentPath) {
+
+    molecule newMolecule = readMoleculeFromCOSMOfile(param, componentPath);
+    finishLoadingNewMolecule(param, newMolecule);
+    writeExtendedSigmaProfileOfNewMolecule(param, newMolecule);
+
     return newMolecule;
 }
 
+// extended sigma profiles may also be compressed
+bool isExtendedSigmaProfilePath(std::string componentPath) {
+    return endsWith(componentPath, ".extsp") || endsWith(componentPath, ".extsp.gz") || endsWith(componentPath, ".extsp.zst");
+}
+
+// the segment types of an extended sigma profile are used without averaging and clustering
+molecule loadNewMoleculeFromExtendedSigmaProfile(parameters& param, std::string componentPath) {
+
+    uint64_t settingsHash;
+    molecule newMolecule = getMoleculeFromExtendedSigmaProfile(componentPath, settingsHash);
+
+    if (settingsHash != getSegmentProfileSettingsHash(param)) {
+        throw std::runtime_error("The extended sigma profile " + componentPath + " was calculated with other settings or another Rav, RavCorr or sigma grid than the current ones.");
+    }
+    if (param.sw_alwaysReloadSigmaProfiles == 1) {
+        throw std::runtime_error("The sigma profiles can not be averaged again for molecules loaded from extended sigma profiles, please set sw_SR_alwaysReloadSigmaProfiles to 0.");
+    }
+    if ((param.dGsolv_E_gas.size() > 0 || param.sw_estimateMolarVolume == 1) && newMolecule.molarVolumeAt25C == 0) {
+        throw std::runtime_error("The extended sigma profile " + componentPath + " does not contain the molar volume, it has to be written while calculating solvation energies or with sw_estimateMolarVolume.");
+    }
+
+    newMolecule.name = getMoleculeNameFromPath(componentPath);
+    newMolecule.finishSegmentProfile(segmentProfiles);
+
+    return newMolecule;
+}
+
+molecule readMoleculeFromLibrary(parameters& param, moleculeLibrary& library, std::string moleculeName) {
+
+    if (library.COSMOfileType != param.sw_COSMOfiles_type) {
+        throw std::runtime_error("The molecule library was created from COSMOfiles of type " + library.COSMOfileType + " and not " + param.sw_COSMOfiles_type + ".");
+    }
+
+    molecule newMolecule;
+    library.readMolecule(moleculeName, newMolecule);
+
+    return newMolecule;
+}
+
+// displays the component paths that were loaded as the same molecule, representativePaths holds for every component path
+// the path the shared molecule was loaded from or "" if the molecule was loaded from the component path itself
+void reportDuplicateMolecules(const std::vector<std::string>& componentPaths, const std::vector<std::string>& representativePaths) {
+
+    std::vector<std::string> sharedRepresentativePaths;
+    std::map<std::string, std::string> aliasesOfRepresentativePath;
+    for (int i = 0; i < int(componentPaths.size()); i++) {
+        if (representativePaths[i] == "")
+            continue;
+
+        auto it = aliasesOfRepresentativePath.emplace(representativePaths[i], componentPaths[i]);
+        if (it.second) {
+            sharedRepresentativePaths.push_back(representativePaths[i]);
+        }
+        else {
+            it.first->second += ", " + componentPaths[i];
+        }
+    }
+
+    if (sharedRepresentativePaths.size() == 0)
+        return;
+
+    display("\nDUPLICATE MOLECULES\n-------------------------\n");
+    for (const std::string& representativePath : sharedRepresentativePaths) {
+        display(representativePath + " is shared with: " + aliasesOfRepresentativePath[representativePath] + "\n");
+    }
+    display("-------------------------\n\n");
+}
+
+// loads the molecules in parallel, they are returned in the order of the component paths.
+// If param.sw_moleculeLibraryPath is set the component paths are the names of the molecules in the library,
+// otherwise paths ending in .extsp are read as extended sigma profiles and all others as COSMOfiles.
+// With param.sw_deduplicateMolecules molecules with the same content after reading are only finished once
+// and share one molecule named after the first of their component paths, also with the molecules of earlier calls.
+std::vector<std::shared_ptr<molecule>> loadNewMolecules(parameters& param, const std::vector<std::string>& componentPaths) {
+
+    std::unique_ptr<moleculeLibrary> library;
+    if (param.sw_moleculeLibraryPath != "") {
+        library.reset(new moleculeLibrary(param.sw_moleculeLibraryPath));
+    }
+
+    const int numberOfComponents = int(componentPaths.size());
+    std::vector<std::shared_ptr<molecule>> newMolecules(numberOfComponents);
+
+    // the index of the component path whose molecule is used, -1 for molecules of earlier calls,
+    // and the name every component path would give its molecule
+    std::vector<int> representativeIndices(numberOfComponents);
+    std::vector<std::string> moleculeNames(numberOfComponents);
+    std::vector<std::string> contents(numberOfComponents);
+    std::vector<std::string> representativePaths(numberOfComponents);
+    std::vector<char> isFinishedInThisCall(numberOfComponents, 0);
+    std::unordered_map<std::string, int> representativeIndexForContent;
+    std::mutex representativeLock;
+
+    threadException e;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < numberOfComponents; i++) {
+        e.run([&, i] {
+            representativeIndices[i] = i;
+
+            if (library == nullptr && isExtendedSigmaProfilePath(componentPaths[i])) {
+                newMolecules[i] = std::make_shared<molecule>(loadNewMoleculeFromExtendedSigmaProfile(param, componentPaths[i]));
+                moleculeNames[i] = newMolecules[i]->name;
+                return;
+            }
+
+            molecule newMolecule = library ? readMoleculeFromLibrary(param, *library, componentPaths[i]) : readMoleculeFromCOSMOfile(param, componentPaths[i]);
+            moleculeNames[i] = newMolecule.name;
+
+            if (param.sw_deduplicateMolecules == 1) {
+                contents[i] = getMoleculeContent(newMolecule);
+                {
+                    std::lock_guard<std::mutex> guard(loadMoleculeLock);
+                    auto it = moleculesForContent.find(contents[i]);
+                    if (it != moleculesForContent.end()) {
+                        representativeIndices[i] = -1;
+                        newMolecules[i] = it->second.first;
+                        representativePaths[i] = it->second.second;
+                        return;
+                    }
+                }
+
+                std::lock_guard<std::mutex> guard(representativeLock);
+                auto it = representativeIndexForContent.emplace(contents[i], i);
+                if (it.second == false) {
+                    representativeIndices[i] = it.first->second;
+                    std::string().swap(contents[i]);
+                    return;
+                }
+            }
+
+            newMolecules[i] = std::make_shared<molecule>(std::move(newMolecule));
+            if (isAveragedOnAllThreads(*newMolecules[i]) == false) {
+                finishLoadingNewMolecule(param, *newMolecules[i]);
+            }
+            isFinishedInThisCall[i] = 1;
+            });
+    }
+    e.rethrow();
+
+    // the molecules with many segments are finished one after another, each of them on all threads
+    for (int i = 0; i < numberOfComponents; i++) {
+        if (isFinishedInThisCall[i] == 1 && isAveragedOnAllThreads(*newMolecules[i])) {
+            finishLoadingNewMolecule(param, *newMolecules[i]);
+        }
+    }
+
+    // the threads may finish a later duplicate first, the shared molecule is named after the first component path
+    std::vector<int> firstIndexOfRepresentative(numberOfComponents, -1);
+    for (int i = 0; i < numberOfComponents; i++) {
+        int representativeIndex = representativeIndices[i];
+        if (representativeIndex == -1)
+            continue;
+
+        if (firstIndexOfRepresentative[representativeIndex] == -1) {
+            firstIndexOfRepresentative[representativeIndex] = i;
+            newMolecules[representativeIndex]->name = moleculeNames[i];
+        }
+        else {
+            representativePaths[i] = componentPaths[firstIndexOfRepresentative[representativeIndex]];
+        }
+        newMolecules[i] = newMolecules[representativeIndex];
+    }
+
+    std::vector<int> finishedIndices;
+    for (int i = 0; i < numberOfComponents; i++) {
+        if (isFinishedInThisCall[i] == 1) {
+            finishedIndices.push_back(i);
+        }
+    }
+
+    // the extended sigma profiles are written once the molecules have their final names
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int j = 0; j < int(finishedIndices.size()); j++) {
+        e.run([&, j] {
+            writeExtendedSigmaProfileOfNewMolecule(param, *newMolecules[finishedIndices[j]]);
+            });
+    }
+    e.rethrow();
+
+    if (param.sw_deduplicateMolecules == 1) {
+        std::lock_guard<std::mutex> guard(loadMoleculeLock);
+        for (int i : finishedIndices) {
+            moleculesForContent.emplace(std::move(contents[i]), std::make_pair(newMolecules[i], componentPaths[firstIndexOfRepresentative[i]]));
+        }
+    }
+
+    reportDuplicateMolecules(componentPaths, representativePaths);
+
+    return newMolecules;
+}
+
+// appends the molecules of the component paths to molecules. With param.sw_loadMoleculesOnDemand only the paths are
+// stored and the molecules stay empty until loadReferencedMolecules is called for a calculation referring to them.
+void addMolecules(parameters& param, const std::vector<std::string>& componentPaths) {
+
+    moleculeComponentPaths.insert(moleculeComponentPaths.end(), componentPaths.begin(), componentPaths.end());
+
+    if (param.sw_loadMoleculesOnDemand == 1) {
+        molecules.resize(molecules.size() + componentPaths.size());
+        return;
+    }
+
+    std::vector<std::shared_ptr<molecule>> newMolecules = loadNewMolecules(param, componentPaths);
+    molecules.insert(molecules.end(), newMolecules.begin(), newMolecules.end());
+
+    reportSigmaProfileApproximations(param);
+}
+
+// loads the molecules of the given indices which have not been loaded yet, all of them in parallel
+void loadReferencedMolecules(parameters& param, const std::vector<int>& moleculeIndices) {
+
+    std::vector<int> indicesToLoad;
+    std::vector<bool> isMarkedToLoad(molecules.size(), false);
+    for (int moleculeIndex : moleculeIndices) {
+        if (moleculeIndex < 0 || moleculeIndex >= int(molecules.size())) {
+            throw std::runtime_error("The component index " + std::to_string(moleculeIndex) + " does not refer to a loaded molecule.");
+        }
+        if (molecules[moleculeIndex] == nullptr && isMarkedToLoad[moleculeIndex] == false) {
+            isMarkedToLoad[moleculeIndex] = true;
+            indicesToLoad.push_back(moleculeIndex);
+        }
+    }
+
+    if (indicesToLoad.size() == 0)
+        return;
+
+    std::vector<std::string> componentPaths;
+    for (int moleculeIndex : indicesToLoad) {
+        componentPaths.push_back(moleculeComponentPaths[moleculeIndex]);
+    }
+
+    std::vector<std::shared_ptr<molecule>> newMolecules = loadNewMolecules(param, componentPaths);
+    for (int i = 0; i < indicesToLoad.size(); i++) {
+        molecules[indicesToLoad[i]] = newMolecules[i];
+    }
+
+    reportSigmaProfileApproximations(param);
+}
+
+// parses the COSMOfiles and writes them into one molecule library, the molecules are named by their file names
+void createMoleculeLibrary(parameters& param, std::string libraryPath, const std::vector<std::string>& componentPaths) {
+
+    moleculeLibraryWriter writer(libraryPath, param.sw_COSMOfiles_type);
+
+    for (const std::string& componentPath : componentPaths) {
+        writer.add(readMoleculeFromCOSMOfile(param, componentPath));
+    }
+
+    writer.finish();
+}
+
+// averages and clusters the molecules of the component paths on all cores and writes their sigma profiles and sigma moments
+// into one sigma profile file without loading them into molecules or setting up any calculation. Every molecule is released
+// once its record is written, the records are written in the order of the component paths as soon as all previous ones are.
+// The molar volumes are only estimated with param.sw_estimateMolarVolume.
+void writeSigmaProfileFile(parameters& param, std::string filePath, const std::vector<std::string>& componentPaths) {
+
+    std::unique_ptr<moleculeLibrary> library;
+    if (param.sw_moleculeLibraryPath != "") {
+        library.reset(new moleculeLibrary(param.sw_moleculeLibraryPath));
+    }
+
+    sigmaProfileFileWriter writer(filePath, getSegmentProfileSettingsHash(param), param.SigmaHB);
+
+    const int numberOfComponents = int(componentPaths.size());
+    std::vector<std::string> finishedRecords(numberOfComponents);
+    int nextRecordToWrite = 0;
+    std::mutex writeLock;
+
+    auto writeFinishedMolecule = [&](int i, molecule& newMolecule) {
+        std::string record;
+        appendSigmaProfileRecord(record, newMolecule, param.SigmaHB);
+
+        // records are never empty, an empty string marks a molecule which is not finished yet
+        std::lock_guard<std::mutex> guard(writeLock);
+        finishedRecords[i] = std::move(record);
+        while (nextRecordToWrite < numberOfComponents && finishedRecords[nextRecordToWrite].size() > 0) {
+            writer.add(finishedRecords[nextRecordToWrite], 1);
+            std::string().swap(finishedRecords[nextRecordToWrite]);
+            nextRecordToWrite++;
+        }
+    };
+
+    // the molecules averaged on all threads are kept until the parallel loop is over
+    std::map<int, molecule> moleculesAveragedOnAllThreads;
+
+    threadException e;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < numberOfComponents; i++) {
+        e.run([&, i] {
+            molecule newMolecule;
+            if (library == nullptr && isExtendedSigmaProfilePath(componentPaths[i])) {
+                newMolecule = loadNewMoleculeFromExtendedSigmaProfile(param, componentPaths[i]);
+                writeFinishedMolecule(i, newMolecule);
+                return;
+            }
+
+            newMolecule = library ? readMoleculeFromLibrary(param, *library, componentPaths[i]) : readMoleculeFromCOSMOfile(param, componentPaths[i]);
+            if (isAveragedOnAllThreads(newMolecule)) {
+                std::lock_guard<std::mutex> guard(writeLock);
+                moleculesAveragedOnAllThreads.emplace(i, std::move(newMolecule));
+                return;
+            }
+
+            finishLoadingNewMolecule(param, newMolecule);
+            writeExtendedSigmaProfileOfNewMolecule(param, newMolecule);
+            writeFinishedMolecule(i, newMolecule);
+            });
+    }
+    e.rethrow();
+
+    for (auto& it : moleculesAveragedOnAllThreads) {
+        finishLoadingNewMolecule(param, it.second);
+        writeExtendedSigmaProfileOfNewMolecule(param, it.second);
+        writeFinishedMolecule(it.first, it.second);
+        it.second = molecule();
+    }
+
+    writer.finish();
+}
+
 void reloadAllMolecules() {
+
+    // molecules loaded on demand which are not referenced by any calculation are empty,
+    // duplicate component paths share one molecule which is only averaged once
+    std::vector<molecule*> moleculesToReload;
+    std::unordered_set<molecule*> isAdded;
+    for (int i = 0; i < molecules.size(); i++) {
+        if (molecules[i] != nullptr && isAdded.insert(molecules[i].get()).second) {
+            moleculesToReload.push_back(molecules[i].get());
+        }
+    }
+
     threadException e;
 #if defined(_OPENMP)
 #pragma omp parallel for
 #endif
-    for (int i = 0; i < molecules.size(); i++) {
+    for (int i = 0; i < moleculesToReload.size(); i++) {
         e.run([=] {
-            molecule _molecule = *molecules[i];
-            int previousNumberOfSegmentTypes = int(_molecule.segments.size());
-            _molecule.segments.clear();
-            averageAndClusterSegments(param, _molecule, previousNumberOfSegmentTypes);
+            molecule& _molecule = *moleculesToReload[i];
+            if (isAveragedOnAllThreads(_molecule) == false) {
+                averageAndClusterSegments(param, _molecule, int(_molecule.profile.size()));
+                _molecule.finishSegmentProfile(segmentProfiles);
+            }
             });
     }
     e.rethrow();
+
+    for (molecule* _molecule : moleculesToReload) {
+        if (isAveragedOnAllThreads(*_molecule)) {
+            averageAndClusterSegments(param, *_molecule, int(_molecule->profile.size()));
+            _molecule->finishSegmentProfile(segmentProfiles);
+        }
+    }
 }
 
 void resizeMonoatomicCations(parameters& param, std::vector<std::shared_ptr<molecule>> molecules) {
@@ -488,7 +1200,7 @@ void resizeMonoatomicCations(parameters& param, std::vector<std::shared_ptr<mole
     // scale A and V for monoatomic cations
     for (int i = 0; i < molecules.size(); i++) {
 
-        if (molecules[i]->moleculeGroup == 3) {
+        if (molecules[i] != nullptr && molecules[i]->moleculeGroup == 3) {
             int AN = molecules[i]->atomAtomicNumbers(0);
             double R_i = param.R_i[AN];
             molecules[i]->Area = (4 * PI * R_i * R_i);
@@ -531,8 +1243,8 @@ void rescaleSegments(parameters& param, calculation& _calculation) {
 
             int ind_molecule = -1;
 
-            for (int k = 0; _calculation.segments.SegmentTypeAreas[ind_left].size(); k++) {
-                if (_calculation.segments.SegmentTypeAreas[ind_left][k] > 0.0) {
+            for (int k = 0; k < _calculation.segments.SegmentTypeAreas.cols(); k++) {
+                if (_calculation.segments.SegmentTypeAreas(ind_left, k) > 0.0) {
                     ind_molecule = k;
                     break;
                 }
@@ -551,56 +1263,140 @@ void rescaleSegments(parameters& param, calculation& _calculation) {
             double AsigmaRight = newArea * (newSigma - sigmaLeft) / param.sigmaStep;
             double AsigmaLeft = newArea * (sigmaRight - newSigma) / param.sigmaStep;
 
-            _calculation.segments.SegmentTypeAreas[ind_left][ind_molecule] = AsigmaLeft;
+            _calculation.segments.SegmentTypeAreas(ind_left, ind_molecule) = AsigmaLeft;
             _calculation.segments.SegmentTypeSigma[ind_left] = (float)sigmaLeft;
 
-            _calculation.segments.SegmentTypeAreas[ind_right][ind_molecule] = AsigmaRight;
+            _calculation.segments.SegmentTypeAreas(ind_right, ind_molecule) = AsigmaRight;
             _calculation.segments.SegmentTypeSigma[ind_right] = (float)sigmaRight;
 
         }
     }
 }
 
-void calculateSegmentConcentrations(calculation& _calculation) {
-    // calculate the mole fraction of segments for each concentration
-    for (int j = 0; j < _calculation.concentrations.size(); j++) {
-
-        int firstNonZeroSegmentIndex = 0;
-        int lastNonZeroSegmentIndex = int(_calculation.concentrations.size()) - 1;
-
-        std::vector<float> segmentConcentration(_calculation.segments.size(), 0.0f);
+// builds the segment types of a calculation from the segment types of its components
+// calculateInteractionMatrix only uses sigma, sigmaCorr and the HB type of the segment types of the groups 0 to 2,
+// the HB type only if the segment is a donor with sigma < -SigmaHB or an acceptor with sigma > SigmaHB.
+// Segment types only differing in the other descriptors have identical rows in Tau and with this identical gammas,
+// these can be merged without changing the results as only the summed area per molecule is needed afterwards.
+// Only descriptors that are irrelevant for any positive SigmaHB are merged as parameters can change between executions.
+void buildCalculationSegments(parameters& param, calculation& _calculation) {
+
+    struct componentSegmentType {
+        unsigned short group;
+        float sigma;
+        float sigmaCorr;
+        unsigned short HBtype;
+        unsigned short atomicNumber;
+        double area;
+    };
+
+    auto compare = [](const componentSegmentType& a, const componentSegmentType& b) {
+        return segmentTypeCollection::compareSegmentTypes(a.group, a.sigma, a.sigmaCorr, a.HBtype, a.atomicNumber,
+            b.group, b.sigma, b.sigmaCorr, b.HBtype, b.atomicNumber);
+    };
+
+    // the segment types of the molecules are kept in the canonical order of segmentTypeCollection::sort.
+    // Merging the descriptors only changes the order within segment types of equal sigma and sigmaCorr,
+    // so the lists are nearly sorted and insertion sort restores the order in linear time.
+    std::vector<std::vector<componentSegmentType>> segmentTypesOfComponents(_calculation.components.size());
+
+    size_t totalNumberOfSegmentTypes = 0;
+    for (int j = 0; j < _calculation.components.size(); j++) {
+
+        const segmentProfile& profile = _calculation.components[j]->profile;
+        std::vector<componentSegmentType>& segmentTypes = segmentTypesOfComponents[j];
+        segmentTypes.reserve(profile.size());
+
+        for (int k = 0; k < profile.size(); k++) {
+
+            componentSegmentType segmentType = { profile.groups()[k], profile.sigmas()[k], profile.sigmaCorrs()[k],
+                profile.HBtypes()[k], profile.atomicNumbers()[k], profile.areas()[k] };
+
+            if (param.sw_mergeEquivalentSegmentTypes == 1 && segmentType.group <= 2) {
+                segmentType.group = 0;
+                segmentType.atomicNumber = 0;
+                if ((segmentType.HBtype == 1 && segmentType.sigma >= 0) || (segmentType.HBtype == 2 && segmentType.sigma <= 0)) {
+                    segmentType.HBtype = 0;
+                }
+            }
 
-        double sumAreaSegmentsConcentrationj = 0.0;
+            size_t position = segmentTypes.size();
+            segmentTypes.push_back(segmentType);
+            while (position > 0 && compare(segmentTypes[position - 1], segmentTypes[position]) > 0) {
+                std::swap(segmentTypes[position - 1], segmentTypes[position]);
+                position--;
+            }
+        }
+        totalNumberOfSegmentTypes += segmentTypes.size();
+    }
 
-        for (int k = 0; k < _calculation.segments.size(); k++) {
+    // k-way merge of the sorted lists of the components directly into the final order
+    _calculation.segments.clear();
+    _calculation.segments.reserve(int(totalNumberOfSegmentTypes));
 
-            double areaSegmentK = 0.0;
+    std::vector<size_t> nextSegmentTypeOfComponent(_calculation.components.size(), 0);
+    while (true) {
 
-            for (int m = 0; m < _calculation.components.size(); m++) {
-                double thisArea = _calculation.concentrations[j][m] * _calculation.segments.SegmentTypeAreas[k][m];
-                areaSegmentK += thisArea;
-                sumAreaSegmentsConcentrationj += thisArea;
+        int nextComponent = -1;
+        for (int j = 0; j < _calculation.components.size(); j++) {
+            if (nextSegmentTypeOfComponent[j] == segmentTypesOfComponents[j].size()) {
+                continue;
             }
+            if (nextComponent == -1 || compare(segmentTypesOfComponents[j][nextSegmentTypeOfComponent[j]],
+                segmentTypesOfComponents[nextComponent][nextSegmentTypeOfComponent[nextComponent]]) < 0) {
+                nextComponent = j;
+            }
+        }
 
-            segmentConcentration[k] = float(areaSegmentK);
+        if (nextComponent == -1) {
+            break;
         }
 
-        double cumulativeSumOfAreasFromSegmentZeroOn = 0.0;
+        const componentSegmentType& segmentType = segmentTypesOfComponents[nextComponent][nextSegmentTypeOfComponent[nextComponent]++];
+        _calculation.segments.appendInOrder((unsigned short)nextComponent, segmentType.group, segmentType.sigma, segmentType.sigmaCorr,
+            segmentType.HBtype, segmentType.atomicNumber, segmentType.area);
+    }
 
-        bool firstNonZeroSegmentIndex_found = false;
-        for (int k = 0; k < _calculation.segments.size(); k++) {
+    _calculation.segments.shrink_to_fit();
+    _calculation.segments.updateGroupBounds();
+}
 
-            cumulativeSumOfAreasFromSegmentZeroOn += segmentConcentration[k];
+void calculateSegmentConcentrations(calculation& _calculation) {
 
-            if (cumulativeSumOfAreasFromSegmentZeroOn != 0 && !firstNonZeroSegmentIndex_found) {
-                firstNonZeroSegmentIndex = k;
-                firstNonZeroSegmentIndex_found = true;
-            }
-            if (segmentConcentration[k] != 0) {
-                lastNonZeroSegmentIndex = k;
-            }
+    const int numberOfSegments = int(_calculation.segments.size());
+    const int numberOfComponents = int(_calculation.components.size());
+    const int numberOfConcentrations = int(_calculation.concentrations.size());
+
+    // the areas of the segment types in the mixture for all concentrations as one matrix product
+    // [segment types x components] * [components x concentrations]
+    Eigen::MatrixXd moleFractions(numberOfComponents, numberOfConcentrations);
+    for (int j = 0; j < numberOfConcentrations; j++) {
+        moleFractions.col(j) = Eigen::Map<Eigen::VectorXf>(_calculation.concentrations[j].data(), numberOfComponents).cast<double>();
+    }
+
+    Eigen::MatrixXd segmentAreasInMixture = _calculation.segments.SegmentTypeAreas.topRows(numberOfSegments) * moleFractions;
+    Eigen::RowVectorXd totalAreasInMixture = segmentAreasInMixture.colwise().sum();
+
+    // calculate the mole fraction of segments for each concentration
+    _calculation.segmentConcentrations.topRows(numberOfSegments) = (segmentAreasInMixture.array().rowwise() / totalAreasInMixture.array()).cast<float>();
 
-            _calculation.segmentConcentrations(k, j) = float(segmentConcentration[k] / sumAreaSegmentsConcentrationj);
+    // the COSMOSPACE calculation only has to consider the range of segment types present in the mixture
+    for (int j = 0; j < numberOfConcentrations; j++) {
+
+        const double* areas = segmentAreasInMixture.col(j).data();
+
+        int firstNonZeroSegmentIndex = 0;
+        while (firstNonZeroSegmentIndex < numberOfSegments && areas[firstNonZeroSegmentIndex] == 0) {
+            firstNonZeroSegmentIndex++;
+        }
+
+        int lastNonZeroSegmentIndex = numberOfSegments - 1;
+        while (lastNonZeroSegmentIndex > firstNonZeroSegmentIndex && areas[lastNonZeroSegmentIndex] == 0) {
+            lastNonZeroSegmentIndex--;
+        }
+
+        if (firstNonZeroSegmentIndex == numberOfSegments) {
+            firstNonZeroSegmentIndex = 0;
         }
 
         _calculation.lowerBoundIndexForCOSMOSPACECalculation[j] = RoundDownToNextMultipleOfEight(firstNonZeroSegmentIndex);
@@ -608,9 +1404,26 @@ void calculateSegmentConcentrations(calculation& _calculation) {
     }
 }
 
+// a calculation can hold up to this number of concentrations including the ones added for the reference states
+const size_t maximumNumberOfConcentrationsOfCalculation = 65535;
+
+// Requests with identical components are merged into calculations of at most this number of requested concentrations.
+// The reference states add at most one concentration per component for every requested concentration.
+// As calculate only solves different calculations in parallel, the concentrations requested in one load
+// are spread over at least as many calculations as there are threads.
+size_t getMaximumNumberOfMergedConcentrations(size_t numberOfRequestedConcentrations, int numberOfComponents) {
+
+    size_t maximumNumberOfMergedConcentrations = maximumNumberOfConcentrationsOfCalculation / size_t(numberOfComponents + 1);
+#if defined(_OPENMP)
+    size_t numberOfThreads = size_t(omp_get_max_threads());
+    maximumNumberOfMergedConcentrations = std::min(maximumNumberOfMergedConcentrations, (numberOfRequestedConcentrations + numberOfThreads - 1) / numberOfThreads);
+#endif
+    return std::max(maximumNumberOfMergedConcentrations, size_t(1));
+}
+
 void finishCalculationInitiation(calculation& _calculation) {
 
-    if (_calculation.concentrations.size() > 65535) {
+    if (_calculation.concentrations.size() > maximumNumberOfConcentrationsOfCalculation) {
         throw std::runtime_error("Too many calculations, other datatype would be necessary for newCalculation.referenceStates to cope with this amount. (unsigned short used so far allowing for up to 65535)");
     }
 
@@ -642,6 +1455,7 @@ void finishCalculationInitiation(calculation& _calculation) {
 
     apply_vector_permutation_in_place(_calculation.concentrations, sortingVector);
     apply_vector_permutation_in_place(_calculation.temperatures, sortingVector);
+    _calculation.clearConcentrationIndex();
 
     _calculation.actualConcentrationIndices = std::vector<int>(_calculation.concentrations.size());
     for (int j = 0; j < _calculation.concentrations.size(); j++) {
@@ -668,6 +1482,59 @@ void finishCalculationInitiation(calculation& _calculation) {
     _calculation.shrink_to_fit();
 }
 
+// binds the outputs of a calculation to its internal matrices,
+// this has to be called once the calculation is at its final position in memory
+void bindCalculationOutputsToInternalData(parameters& param, calculation& _calculation) {
+
+    const int numberOfRows = int(_calculation.originalNumberOfCalculations);
+    const int numberOfComponents = int(_calculation.components.size());
+
+    _calculation.lnGammaCombinatorial_data = Eigen::MatrixXf::Zero(numberOfRows, numberOfComponents);
+    new (&_calculation.lnGammaCombinatorial) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+        _calculation.lnGammaCombinatorial_data.data(), numberOfRows, numberOfComponents);
+
+    _calculation.lnGammaResidual_data = Eigen::MatrixXf::Zero(numberOfRows, numberOfComponents);
+    new (&_calculation.lnGammaResidual) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+        _calculation.lnGammaResidual_data.data(), numberOfRows, numberOfComponents);
+
+    _calculation.lnGammaTotal_data = Eigen::MatrixXf::Zero(numberOfRows, numberOfComponents);
+    new (&_calculation.lnGammaTotal) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+        _calculation.lnGammaTotal_data.data(), numberOfRows, numberOfComponents);
+
+    _calculation.dGsolv_data = Eigen::MatrixXf::Zero(numberOfRows, numberOfComponents);
+    new (&_calculation.dGsolv) Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+        _calculation.dGsolv_data.data(), numberOfRows, numberOfComponents);
+
+    if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
+
+        _calculation.contactStatistics_data = Eigen::Tensor<float, 3, Eigen::RowMajor>(numberOfRows, numberOfComponents, numberOfComponents);
+        _calculation.contactStatistics_data.setZero();
+        new (&_calculation.contactStatistics) Eigen::TensorMap<Eigen::Tensor<float, 3, Eigen::RowMajor>>(_calculation.contactStatistics_data.data(),
+            numberOfRows, numberOfComponents, numberOfComponents);
+
+        _calculation.averageSurfaceEnergies_data = Eigen::Tensor<float, 4, Eigen::RowMajor>(numberOfRows,
+            int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
+            numberOfComponents, numberOfComponents);
+        _calculation.averageSurfaceEnergies_data.setZero();
+        new (&_calculation.averageSurfaceEnergies) Eigen::TensorMap<Eigen::Tensor<float, 4, Eigen::RowMajor>>(_calculation.averageSurfaceEnergies_data.data(),
+            numberOfRows,
+            int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
+            numberOfComponents, numberOfComponents);
+
+        if (param.sw_calculateContactStatisticsAndAdditionalProperties == 2) {
+
+            _calculation.partialMolarEnergies_data = Eigen::Tensor<float, 3, Eigen::RowMajor>(numberOfRows,
+                int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
+                numberOfComponents);
+            _calculation.partialMolarEnergies_data.setZero();
+            new (&_calculation.partialMolarEnergies) Eigen::TensorMap<Eigen::Tensor<float, 3, Eigen::RowMajor>>(_calculation.partialMolarEnergies_data.data(),
+                numberOfRows,
+                int(param.numberOfPartialInteractionMatrices) + 1, // +1 because A_int is the first one
+                numberOfComponents);
+        }
+    }
+}
+
 void calculateLnGammaCombinatorial(parameters& param, calculation& _calculation) {
 
     std::vector<double> averageVolumes(_calculation.concentrations.size(), 0.0);
@@ -823,18 +1690,27 @@ void calculateLnGammaCombinatorial(parameters& param, calculation& _calculation)
 // instead of calculating the complete matrix-vector product and then calculating the gammas for the next iteration
 // each row is calculated and the gamma for the row just calculated is already used in the calculation of the next row.
 // This was done firstly by accident, but it was found, that it accelerated the convergence by a factor of at least 4.
-void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
+// with onlySolveRepeatedStates only the repeated states this calculation has to solve for the others are solved and stored
+void calculateLnGammaResidual(parameters& param, calculation& _calculation, bool onlySolveRepeatedStates = false) {
 
     const int numberOfSegments = int(_calculation.segments.size());
     const int nMultipleOfEight = RoundUpToNextMultipleOfEight(numberOfSegments);
 
     Eigen::MatrixXf temporary_lnGammaMolecule = Eigen::MatrixXf::Zero(_calculation.concentrations.size(), _calculation.components.size());
+    Eigen::VectorXd lnGammas(numberOfSegments);
 
+    Eigen::Tensor<float, 3, Eigen::RowMajor> temporary_contactStatistics;
     Eigen::Tensor<float, 4, Eigen::RowMajor> temporary_averageInteractionEnergies;
     Eigen::Tensor<float, 3, Eigen::RowMajor> temporary_partialMolarEnergies;
 
     if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
 
+        temporary_contactStatistics = Eigen::Tensor<float, 3, Eigen::RowMajor>(int(_calculation.concentrations.size()),
+            int(_calculation.components.size()),
+            int(_calculation.components.size()));
+
+        temporary_contactStatistics.setZero();
+
         temporary_averageInteractionEnergies = Eigen::Tensor<float, 4, Eigen::RowMajor>(int(_calculation.concentrations.size()),
             param.numberOfPartialInteractionMatrices + 1, // +1 because A_int is the first one
             int(_calculation.components.size()),
@@ -880,8 +1756,24 @@ void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
         }
     }
 
+    const bool reuseSolvedStates = param.sw_reuseSolvedStates == 1 && param.sw_calculateContactStatisticsAndAdditionalProperties == 0;
+
     for (int g = 0; g < _calculation.TauConcentrationIndices.size(); g++) {
 
+        // Tau is only needed if one of the concentrations is solved
+        if (onlySolveRepeatedStates) {
+            bool solvesRepeatedState = false;
+            for (int i : _calculation.TauConcentrationIndices[g]) {
+                if (solvedStates.isSolvedBy(solvedStateKey(_calculation, i), _calculation, i)) {
+                    solvesRepeatedState = true;
+                    break;
+                }
+            }
+            if (solvesRepeatedState == false) {
+                continue;
+            }
+        }
+
         // conditions
         float temperature = _calculation.TauTemperatures[g];
 
@@ -948,6 +1840,27 @@ void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
             int i = _calculation.TauConcentrationIndices[g][h];
 
             float* gammas = &(_calculation.segmentGammas(0, i));
+
+            // states that occur in more than one calculation are solved once before and read from the cache,
+            // if the cached state lacks some components its solution is used as initial point
+            solvedStateKey stateKey;
+            bool storeSolvedState = false;
+            if (reuseSolvedStates) {
+                stateKey = solvedStateKey(_calculation, i);
+                if (onlySolveRepeatedStates) {
+                    storeSolvedState = solvedStates.isSolvedBy(stateKey, _calculation, i);
+                    if (storeSolvedState == false) {
+                        continue;
+                    }
+                }
+                else if (solvedStates.isRepeated(stateKey) && solvedStates.find(stateKey, _calculation, gammas, temporary_lnGammaMolecule, i)) {
+                    continue;
+                }
+            }
+            else if (onlySolveRepeatedStates) {
+                continue;
+            }
+
 #ifdef MEASURE_TIME
             std::chrono::high_resolution_clock::time_point calculateCOSMOSPACE_last = std::chrono::high_resolution_clock::now();
 #endif
@@ -1118,7 +2031,7 @@ void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
 
 
             if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
-                calculateContactStatistics(_calculation, A_int, partialInteractionMatrices, Tau, gammas, int(i), temporary_averageInteractionEnergies, temporary_partialMolarEnergies, param);
+                calculateContactStatistics(_calculation, A_int, partialInteractionMatrices, Tau, gammas, int(i), temporary_contactStatistics, temporary_averageInteractionEnergies, temporary_partialMolarEnergies, param);
             }
 
 #ifdef MEASURE_TIME
@@ -1127,15 +2040,13 @@ void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
 #endif
             double div_Aeff = 1 / param.Aeff;
 
-            for (int j = 0; j < _calculation.components.size(); j++) {
-
-                double lnGammaMolecule = 0;
-
-                for (int k = 0; k < numberOfSegments; k++) {
-                    lnGammaMolecule += _calculation.segments.SegmentTypeAreas[k][j] * div_Aeff * log(gammas[k]); // log(gammas[k]) is calculated more than once although not necessary
-                }
+            // the logarithm of the segment gammas is calculated once vectorized, the molecular values
+            // of all components follow as one matrix-vector product with the area matrix
+            lnGammas = Eigen::Map<Eigen::VectorXf>(gammas, numberOfSegments).cast<double>().array().log();
+            temporary_lnGammaMolecule.row(i) = (div_Aeff * (_calculation.segments.SegmentTypeAreas.topRows(numberOfSegments).transpose() * lnGammas)).cast<float>().transpose();
 
-                temporary_lnGammaMolecule(i, j) = float(lnGammaMolecule);
+            if (storeSolvedState) {
+                solvedStates.store(stateKey, _calculation, gammas, temporary_lnGammaMolecule, i);
             }
 
 #ifdef MEASURE_TIME
@@ -1144,6 +2055,10 @@ void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
         }
     }
 
+    if (onlySolveRepeatedStates) {
+        return;
+    }
+
 #ifdef MEASURE_TIME
     std::chrono::high_resolution_clock::time_point calculateGammasForMolecules_last = std::chrono::high_resolution_clock::now();
 #endif
@@ -1165,6 +2080,7 @@ void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
 
             if (param.sw_calculateContactStatisticsAndAdditionalProperties > 0) {
                 for (int k = 0; k < _calculation.components.size(); k++) {
+                    _calculation.contactStatistics(h, j, k) = temporary_contactStatistics(i, j, k);
                     _calculation.averageSurfaceEnergies(h, 0, j, k) = multiplier * temporary_averageInteractionEnergies(i, 0, j, k);
 
                     for (int l = 0; l < param.numberOfPartialInteractionMatrices; l++) {
@@ -1176,7 +2092,7 @@ void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
                     _calculation.partialMolarEnergies(h, 0, j) = multiplier * temporary_partialMolarEnergies(i, 0, j);
 
                     for (int l = 0; l < param.numberOfPartialInteractionMatrices; l++) {
-                        _calculation.partialMolarEnergies(h, l + 1, j) = multiplier * temporary_partialMolarEnergies(h, l + 1, j);
+                        _calculation.partialMolarEnergies(h, l + 1, j) = multiplier * temporary_partialMolarEnergies(i, l + 1, j);
                     }
                 }
             }
@@ -1215,6 +2131,18 @@ void calculateLnGammaResidual(parameters& param, calculation& _calculation) {
 
 void calculate(std::vector<int>& calculationIndices) {
 
+    // find the states that occur in more than one calculation, e.g. the pure component reference states
+    solvedStates.clear();
+    const bool reuseSolvedStates = param.sw_reuseSolvedStates == 1 && param.sw_calculateContactStatisticsAndAdditionalProperties == 0;
+    if (reuseSolvedStates) {
+        for (int i = 0; i < calculationIndices.size(); i++) {
+            calculation& _calculation = calculations[calculationIndices[i]];
+            for (int j = 0; j < _calculation.concentrations.size(); j++) {
+                solvedStates.addOccurence(solvedStateKey(_calculation, j), _calculation, j);
+            }
+        }
+    }
+
     // this is needed to catch exceptions in the OPENMP threads and rethrow them after the parallel section ends
     threadException e;
 #if defined(_OPENMP)
@@ -1231,22 +2159,7 @@ void calculate(std::vector<int>& calculationIndices) {
 #endif
             if (param.sw_alwaysReloadSigmaProfiles == 1 && n_ex > 3) {
 
-                calculations[calculationIndex].segments.clear();
-
-                for (int j = 0; j < calculations[calculationIndex].components.size(); j++) {
-
-                    std::shared_ptr<molecule> thisMolecule = calculations[calculationIndex].components[j];
-
-                    for (int k = 0; k < thisMolecule->segments.size(); k++) {
-                        calculations[calculationIndex].segments.add((unsigned short)j, thisMolecule->segments.SegmentTypeGroup[k],
-                            thisMolecule->segments.SegmentTypeSigma[k],
-                            thisMolecule->segments.SegmentTypeSigmaCorr[k],
-                            thisMolecule->segments.SegmentTypeHBtype[k],
-                            thisMolecule->segments.SegmentTypeAtomicNumber[k],
-                            thisMolecule->segments.SegmentTypeAreas[k][0]);
-                    }
-                }
-                calculations[calculationIndex].segments.sort();
+                buildCalculationSegments(param, calculations[calculationIndex]);
                 calculations[calculationIndex].segmentGammas = Eigen::MatrixXf::Constant(RoundUpToNextMultipleOfEight(int(calculations[calculationIndex].segments.size())), int(calculations[calculationIndex].concentrations.size()), 1.0f);
                 calculations[calculationIndex].segmentConcentrations = Eigen::MatrixXf::Zero(RoundUpToNextMultipleOfEight(int(calculations[calculationIndex].segments.size())), int(calculations[calculationIndex].concentrations.size()));
             }
@@ -1279,6 +2192,31 @@ void calculate(std::vector<int>& calculationIndices) {
             std::chrono::high_resolution_clock::time_point calculateResidual_last = std::chrono::high_resolution_clock::now();
 #endif
 
+            // the repeated states are solved before all other states so that every calculation reads the same cached solution
+            if (reuseSolvedStates) {
+                calculateLnGammaResidual(param, calculations[calculationIndex], true);
+            }
+
+#ifdef MEASURE_TIME
+            calculateResidual_total_ms += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - calculateResidual_last).count();
+#endif
+        });
+    }
+    e.rethrow();
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < calculationIndices.size(); i++) {
+
+        e.run([=] {
+
+            int calculationIndex = calculationIndices[i];
+
+#ifdef MEASURE_TIME
+            std::chrono::high_resolution_clock::time_point calculateResidual_last = std::chrono::high_resolution_clock::now();
+#endif
+
             // calculate residual part
             calculateLnGammaResidual(param, calculations[calculationIndex]);
 
@@ -1296,32 +2234,34 @@ void calculate(std::vector<int>& calculationIndices) {
                 double approximate_dGsolv_tau = 0.0262; // median of other values
                 for (int i_concentration = 0; i_concentration < calculations[calculationIndex].originalNumberOfCalculations; i_concentration++) {
                     if (calculations[calculationIndex].referenceStateType[i_concentration] == 4) {
+                        // concentrations and temperatures are saved sorted by conditions
+                        int i_sortedConcentration = calculations[calculationIndex].actualConcentrationIndices[i_concentration];
                         int i_solvent_component = -1;
                         for (int i_component = 0; i_component < calculations[calculationIndex].components.size(); i_component++) {
-                            if (calculations[calculationIndex].concentrations[i_concentration][i_component] == 1.0f) {
+                            if (calculations[calculationIndex].concentrations[i_sortedConcentration][i_component] == 1.0f) {
                                 i_solvent_component = i_component;
                                 break;
                             }
                         }
                         for (int i_component = 0; i_component < calculations[calculationIndex].components.size(); i_component++) {
                             double dGsolv = 0.0;
-                            if (calculations[calculationIndex].concentrations[i_concentration][i_component] == 0.0f) {
+                            if (calculations[calculationIndex].concentrations[i_sortedConcentration][i_component] == 0.0f) {
 
-                                double RT = R_GAS_CONSTANT * calculations[calculationIndex].temperatures[i_concentration];
+                                double RT = R_GAS_CONSTANT * calculations[calculationIndex].temperatures[i_sortedConcentration];
                                 double molar_volume_ideal_gas = RT / reference_pressure;
                                 double RT_kcalPerMol = RT / (1000 * 4.184);
 
                                 // all energies calculated below this line are in kcal/mol
                                 double E_vdw = 0.0;
-                                segmentTypeCollection segments = calculations[calculationIndex].components[i_component]->segments;
+                                const segmentProfile& profile = calculations[calculationIndex].components[i_component]->profile;
                                 std::unordered_map<int, double> areasByAtomicNumber;
-                                for (int i_segment = 0; i_segment < segments.size(); i_segment++) {
-                                    int AN = segments.SegmentTypeAtomicNumber[i_segment];
+                                for (int i_segment = 0; i_segment < profile.size(); i_segment++) {
+                                    int AN = profile.atomicNumbers()[i_segment];
 
                                     if (areasByAtomicNumber.find(AN) == areasByAtomicNumber.end())
                                         areasByAtomicNumber[AN] = 0.0;
 
-                                    areasByAtomicNumber[AN] += segments.SegmentTypeAreas[i_segment][0];
+                                    areasByAtomicNumber[AN] += profile.areas()[i_segment];
                                 }
 
                                 for (auto& it : areasByAtomicNumber) {
@@ -1356,6 +2296,7 @@ void calculate(std::vector<int>& calculationIndices) {
                         throw std::runtime_error("For the following atomic numbers not all parameters are available for the calculation of solvation energies: " + ANs);
                     }
                     else {
+                        std::lock_guard<std::mutex> guard(loadMoleculeLock);
                         warnings.push_back(" - For the following atomic numbers not all parameters are available for the calculation of solvation energies, an estimate was used: " + ANs);
                     }
 
@@ -67,8 +67,16 @@ std::string vectorization_level = "vectorization: SSE3";
 #include "helper_functions.hpp"
 
 std::vector<std::shared_ptr<molecule>> molecules;
+std::vector<std::string> moleculeComponentPaths; // component path of every entry of molecules, used to load molecules on demand
+segmentProfileArena segmentProfiles; // memory of the compact segment profiles of the loaded molecules
+// with param.sw_deduplicateMolecules the loaded molecules by the content of their COSMOfile together with the component path
+// they were loaded from, so that all later loads of the same content share them. Guarded by loadMoleculeLock
+std::unordered_map<std::string, std::pair<std::shared_ptr<molecule>, std::string>> moleculesForContent;
 std::vector<calculation> calculations;
+std::vector<calculationRequest> calculationRequests;
 std::vector<std::string> warnings;
+std::mutex loadMoleculeLock; // guards param.R_i_COSMO and warnings while molecules are loaded in parallel
+solvedStatesCache solvedStates;
 
 parameters param;
 int n_ex = -1;
\ No newline at end of file
@@ -157,7 +157,10 @@ void WriteEigenMatrixtoFile(std::string Path, Eigen::MatrixXd m) {
 	fclose(fp);
 }
 
-void WriteExtendedSigmaProfiletoFile(std::string Path, segmentTypeCollection& segments) {
+// Extended sigma profile of a molecule: header lines starting with "#" holding the molecule properties and the hash of
+// the settings the segment types depend on, followed by one line per segment type. The values are written with enough
+// digits to be read back exactly by getMoleculeFromExtendedSigmaProfile.
+void WriteExtendedSigmaProfiletoFile(std::string Path, molecule& _molecule, uint64_t settingsHash) {
 
 	FILE* fp = NULL;
 	fp = fopen(Path.c_str(), "w");
@@ -165,9 +168,27 @@ void WriteExtendedSigmaProfiletoFile(std::string Path, segmentTypeCollection& se
 		throw std::runtime_error("Could not open file: " + Path);
 	}
 
-	for (int i = 0; i < segments.size(); i++) {
-		fprintf(fp, "%4d  %14.6e  %14.6e  %4d  %3d  %3d  %14.6e\n", i, segments.SegmentTypeSigma[i], segments.SegmentTypeSigmaCorr[i], segments.SegmentTypeAtomicNumber[i], \
-			segments.SegmentTypeHBtype[i], segments.SegmentTypeGroup[i], segments.SegmentTypeAreas[i][0]);
+	const segmentProfile& profile = _molecule.profile;
+
+	fprintf(fp, "# openCOSMO-RS extended sigma profile\n");
+	fprintf(fp, "# name: %s\n", _molecule.name.c_str());
+	fprintf(fp, "# qmMethod: %s\n", _molecule.qmMethod.c_str());
+	fprintf(fp, "# settings: %016llx\n", (unsigned long long)settingsHash);
+	fprintf(fp, "# Area: %.17e\n", _molecule.Area);
+	fprintf(fp, "# Volume: %.17e\n", _molecule.Volume);
+	fprintf(fp, "# epsilonInfinityTotalEnergy: %.17e\n", _molecule.epsilonInfinityTotalEnergy);
+	fprintf(fp, "# molarVolumeAt25C: %.17e\n", _molecule.molarVolumeAt25C);
+	fprintf(fp, "# moleculeCharge: %d\n", int(_molecule.moleculeCharge));
+	fprintf(fp, "# moleculeGroup: %d\n", int(_molecule.moleculeGroup));
+	fprintf(fp, "# atomicNumbers:");
+	for (int i = 0; i < _molecule.atomAtomicNumbers.size(); i++) {
+		fprintf(fp, " %d", _molecule.atomAtomicNumbers(i));
+	}
+	fprintf(fp, "\n");
+
+	for (int i = 0; i < profile.size(); i++) {
+		fprintf(fp, "%4d  %16.9e  %16.9e  %4d  %3d  %3d  %24.17e\n", i, profile.sigmas()[i], profile.sigmaCorrs()[i], profile.atomicNumbers()[i], \
+			profile.HBtypes()[i], profile.groups()[i], profile.areas()[i]);
 	}
 
 	fclose(fp);
@@ -0,0 +1,469 @@
+/*
+    c++ implementation of openCOSMO-RS including multiple segment descriptors
+    @author: Simon Mueller, 2022
+*/
+
+
+#pragma once
+#include "COSMOfile_functions.hpp"
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <thread>
+#include <atomic>
+
+// FNV-1a
+static uint64_t calculateContentHash(const char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t roundUpToMultipleOfEightBytes(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+// Binary record of a molecule directly after parsing, used by the molecule cache and the molecule library.
+// After the header follow the qmMethod and the name, the doubles of atomPositions, atomRadii, segmentPositions,
+// segmentAreas and segmentSigmas and the int32 of atomAtomicNumbers and segmentAtomIndices, each part padded to eight bytes.
+
+struct moleculeRecordHeader {
+    uint64_t numberOfAtoms;
+    uint64_t numberOfSegments;
+
+    double Area;
+    double Volume;
+    double epsilonInfinityTotalEnergy;
+
+    uint64_t qmMethodLength;
+    uint64_t nameLength;
+};
+
+// without the name the record only holds what was read from the COSMOfile
+void appendMoleculeRecord(std::string& content, const molecule& parsedMolecule, bool includeName = true) {
+
+    moleculeRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.numberOfAtoms = uint64_t(parsedMolecule.atomAtomicNumbers.size());
+    header.numberOfSegments = uint64_t(parsedMolecule.segmentAreas.size());
+    header.Area = parsedMolecule.Area;
+    header.Volume = parsedMolecule.Volume;
+    header.epsilonInfinityTotalEnergy = parsedMolecule.epsilonInfinityTotalEnergy;
+    header.qmMethodLength = parsedMolecule.qmMethod.size();
+    header.nameLength = includeName ? parsedMolecule.name.size() : 0;
+
+    content.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    content += parsedMolecule.qmMethod;
+    if (includeName)
+        content += parsedMolecule.name;
+    content.resize(roundUpToMultipleOfEightBytes(content.size()), '\0');
+
+    auto appendDoubles = [&](const Eigen::MatrixXd& values) {
+        content.append(reinterpret_cast<const char*>(values.data()), sizeof(double) * values.size());
+    };
+    auto appendIntegers = [&](const Eigen::VectorXi& values) {
+        Eigen::Matrix<int32_t, Eigen::Dynamic, 1> integers = values.cast<int32_t>();
+        content.append(reinterpret_cast<const char*>(integers.data()), sizeof(int32_t) * integers.size());
+        content.resize(roundUpToMultipleOfEightBytes(content.size()), '\0');
+    };
+
+    appendDoubles(parsedMolecule.atomPositions);
+    appendDoubles(parsedMolecule.atomRadii);
+    appendDoubles(parsedMolecule.segmentPositions);
+    appendDoubles(parsedMolecule.segmentAreas);
+    appendDoubles(parsedMolecule.segmentSigmas);
+    appendIntegers(parsedMolecule.atomAtomicNumbers);
+    appendIntegers(parsedMolecule.segmentAtomIndices);
+}
+
+// returns false if the size does not match the record, the record has to start at an address aligned to eight bytes
+bool readMoleculeRecord(const char* data, size_t size, molecule& parsedMolecule) {
+
+    moleculeRecordHeader header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+
+    size_t stringsSize = roundUpToMultipleOfEightBytes(header.qmMethodLength + header.nameLength);
+    size_t expectedSize = sizeof(header) + stringsSize
+        + sizeof(double) * (4 * header.numberOfAtoms + 5 * header.numberOfSegments)
+        + roundUpToMultipleOfEightBytes(sizeof(int32_t) * header.numberOfAtoms)
+        + roundUpToMultipleOfEightBytes(sizeof(int32_t) * header.numberOfSegments);
+    if (size != expectedSize)
+        return false;
+
+    Eigen::Index numberOfAtoms = Eigen::Index(header.numberOfAtoms);
+    Eigen::Index numberOfSegments = Eigen::Index(header.numberOfSegments);
+
+    const char* position = data + sizeof(header);
+    parsedMolecule.qmMethod = std::string(position, size_t(header.qmMethodLength));
+    parsedMolecule.name = std::string(position + header.qmMethodLength, size_t(header.nameLength));
+    position += stringsSize;
+
+    auto readDoubles = [&](Eigen::Index numberOfValues) {
+        const double* values = (const double*)position;
+        position += sizeof(double) * numberOfValues;
+        return values;
+    };
+    auto readIntegers = [&](Eigen::Index numberOfValues) {
+        const int32_t* values = (const int32_t*)position;
+        position += roundUpToMultipleOfEightBytes(sizeof(int32_t) * numberOfValues);
+        return values;
+    };
+
+    parsedMolecule.Area = header.Area;
+    parsedMolecule.Volume = header.Volume;
+    parsedMolecule.epsilonInfinityTotalEnergy = header.epsilonInfinityTotalEnergy;
+
+    parsedMolecule.atomPositions = Eigen::Map<const Eigen::MatrixXd>(readDoubles(3 * numberOfAtoms), numberOfAtoms, 3);
+    parsedMolecule.atomRadii = Eigen::Map<const Eigen::VectorXd>(readDoubles(numberOfAtoms), numberOfAtoms);
+    parsedMolecule.segmentPositions = Eigen::Map<const Eigen::MatrixXd>(readDoubles(3 * numberOfSegments), numberOfSegments, 3);
+    parsedMolecule.segmentAreas = Eigen::Map<const Eigen::VectorXd>(readDoubles(numberOfSegments), numberOfSegments);
+    parsedMolecule.segmentSigmas = Eigen::Map<const Eigen::VectorXd>(readDoubles(numberOfSegments), numberOfSegments);
+    parsedMolecule.atomAtomicNumbers = Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>>(readIntegers(numberOfAtoms), numberOfAtoms).cast<int>();
+    parsedMolecule.segmentAtomIndices = Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>>(readIntegers(numberOfSegments), numberOfSegments).cast<int>();
+
+    return true;
+}
+
+// everything read from a COSMOfile except the name, which is derived from the path.
+// Molecules with the same content are treated as the same molecule.
+std::string getMoleculeContent(const molecule& parsedMolecule) {
+
+    std::string content;
+    appendMoleculeRecord(content, parsedMolecule, false);
+    return content;
+}
+
+// Binary cache of the molecules parsed from COSMOfiles. For every COSMOfile one cache file is written to the
+// directory param.sw_moleculeCacheDirectory, it contains the path, the COSMOfile type and the record of the molecule.
+// A cache file is used if it was written by the same version for the same path and COSMOfile type and
+// the COSMOfile has the same size and modification time, or if only the modification time differs
+// but the content hash is still the same.
+
+const char moleculeCacheMagic[8] = { 'O', 'C', 'R', 'S', 'M', 'O', 'L', '\0' };
+const uint32_t moleculeCacheVersion = 2;
+
+struct moleculeCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sizeOfDouble;
+
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint64_t sourceContentHash;
+
+    uint64_t pathLength;
+    uint64_t COSMOfileTypeLength;
+};
+
+static bool getFileSizeAndModificationTime(const std::string& path, uint64_t& size, int64_t& modificationTime) {
+    struct stat fileStatus;
+    if (stat(path.c_str(), &fileStatus) != 0)
+        return false;
+
+    size = uint64_t(fileStatus.st_size);
+    modificationTime = int64_t(fileStatus.st_mtime);
+    return true;
+}
+
+// the cache files are named by the hash of their key
+static std::string getCacheFilePath(parameters& param, const std::string& key, const std::string& extension) {
+
+    uint64_t hash = calculateContentHash(key.data(), key.size());
+
+    char hashString[17];
+    snprintf(hashString, sizeof(hashString), "%016llx", (unsigned long long)hash);
+
+    std::string directory = param.sw_moleculeCacheDirectory;
+    if (directory.back() != '/' && directory.back() != '\\')
+        directory += "/";
+
+    return directory + hashString + extension;
+}
+
+static std::string getMoleculeCacheFilePath(parameters& param, const std::string& path) {
+    return getCacheFilePath(param, path + "|" + param.sw_COSMOfiles_type, ".ocrsmol");
+}
+
+// returns true and fills the molecule if a valid cache file exists
+bool readMoleculeFromCache(parameters& param, const std::string& path, molecule& cachedMolecule) {
+
+    memoryMappedFile cacheFile(getMoleculeCacheFilePath(param, path));
+    if (!cacheFile.isOpen())
+        return false;
+
+    const char* data = cacheFile.begin();
+    size_t size = size_t(cacheFile.end() - cacheFile.begin());
+
+    moleculeCacheHeader header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, moleculeCacheMagic, sizeof(moleculeCacheMagic)) != 0 || header.version != moleculeCacheVersion || header.sizeOfDouble != sizeof(double))
+        return false;
+
+    size_t recordOffset = sizeof(header) + roundUpToMultipleOfEightBytes(header.pathLength + header.COSMOfileTypeLength);
+    if (size < recordOffset)
+        return false;
+
+    const char* position = data + sizeof(header);
+    if (std::string(position, size_t(header.pathLength)) != path || std::string(position + header.pathLength, size_t(header.COSMOfileTypeLength)) != param.sw_COSMOfiles_type)
+        return false;
+
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    if (!getFileSizeAndModificationTime(path, sourceSize, sourceModificationTime) || sourceSize != header.sourceSize)
+        return false;
+
+    if (sourceModificationTime != header.sourceModificationTime) {
+        memoryMappedFile sourceFile(path);
+        if (!sourceFile.isOpen() || calculateContentHash(sourceFile.begin(), size_t(sourceFile.end() - sourceFile.begin())) != header.sourceContentHash)
+            return false;
+    }
+
+    return readMoleculeRecord(data + recordOffset, size - recordOffset, cachedMolecule);
+}
+
+// writes the content to a temporary file which is renamed afterwards, so that concurrent readers never see incomplete files.
+// Failing to write the cache is not an error.
+static void writeCacheFile(const std::string& cacheFilePath, const std::string& content) {
+
+    static std::atomic<unsigned long> numberOfTemporaryFiles(0);
+    std::string temporaryFilePath = cacheFilePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "_" + std::to_string(numberOfTemporaryFiles++);
+
+    FILE* temporaryFile = fopen(temporaryFilePath.c_str(), "wb");
+    if (temporaryFile == NULL)
+        return;
+
+    bool written = fwrite(content.data(), 1, content.size(), temporaryFile) == content.size();
+    written = fclose(temporaryFile) == 0 && written;
+
+#if defined(_WIN32)
+    // on Windows rename does not replace existing files
+    if (written)
+        std::remove(cacheFilePath.c_str());
+#endif
+    if (written == false || std::rename(temporaryFilePath.c_str(), cacheFilePath.c_str()) != 0) {
+        std::remove(temporaryFilePath.c_str());
+    }
+}
+
+// writes the parsed molecule, failing to write the cache is not an error
+void writeMoleculeToCache(parameters& param, const std::string& path, const molecule& parsedMolecule) {
+
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    if (!getFileSizeAndModificationTime(path, sourceSize, sourceModificationTime))
+        return;
+
+    moleculeCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, moleculeCacheMagic, sizeof(moleculeCacheMagic));
+    header.version = moleculeCacheVersion;
+    header.sizeOfDouble = sizeof(double);
+    header.sourceSize = sourceSize;
+    header.sourceModificationTime = sourceModificationTime;
+    {
+        memoryMappedFile sourceFile(path);
+        if (!sourceFile.isOpen())
+            return;
+        header.sourceContentHash = calculateContentHash(sourceFile.begin(), size_t(sourceFile.end() - sourceFile.begin()));
+    }
+    header.pathLength = path.size();
+    header.COSMOfileTypeLength = param.sw_COSMOfiles_type.size();
+
+    std::string content(reinterpret_cast<const char*>(&header), sizeof(header));
+    content += path + param.sw_COSMOfiles_type;
+    content.resize(roundUpToMultipleOfEightBytes(content.size()), '\0');
+    appendMoleculeRecord(content, parsedMolecule);
+
+    writeCacheFile(getMoleculeCacheFilePath(param, path), content);
+}
+
+// Binary cache of the segment types of the molecules after averaging and clustering, stored in the same directory.
+// The file name is derived from a key holding all settings averageAndClusterSegments depends on and
+// a content hash of the segment data of the molecule, the full key is stored in the file and compared on reading.
+
+const char segmentProfileCacheMagic[8] = { 'O', 'C', 'R', 'S', 'P', 'R', 'F', '\0' };
+const uint32_t segmentProfileCacheVersion = 2;
+
+// the part of the key holding the settings, also used to check that extended sigma profiles fit the settings
+static std::string getSegmentProfileSettingsKey(parameters& param) {
+
+    std::string key;
+    auto appendValue = [&](const void* value, size_t size) {
+        key.append(reinterpret_cast<const char*>(value), size);
+    };
+
+    appendValue(segmentProfileCacheMagic, sizeof(segmentProfileCacheMagic));
+    appendValue(&segmentProfileCacheVersion, sizeof(segmentProfileCacheVersion));
+
+    appendValue(&param.Rav, sizeof(param.Rav));
+    appendValue(&param.RavCorr, sizeof(param.RavCorr));
+    appendValue(&param.sw_misfit, sizeof(param.sw_misfit));
+    appendValue(&param.sw_atomicNumber, sizeof(param.sw_atomicNumber));
+    appendValue(&param.sw_differentiateHydrogens, sizeof(param.sw_differentiateHydrogens));
+    appendValue(&param.sw_differentiateMoleculeGroups, sizeof(param.sw_differentiateMoleculeGroups));
+    appendValue(&param.sw_sigmaAveragingWeightCutoff, sizeof(param.sw_sigmaAveragingWeightCutoff));
+    appendValue(&param.sw_singlePrecisionSegmentDistances, sizeof(param.sw_singlePrecisionSegmentDistances));
+    appendValue(&param.sw_sigmaGridCoarseningFactor, sizeof(param.sw_sigmaGridCoarseningFactor));
+    appendValue(&param.sigmaMin, sizeof(param.sigmaMin));
+    appendValue(&param.sigmaStep, sizeof(param.sigmaStep));
+
+    uint64_t numberOfChargeRasterValues = param.ChargeRaster.size();
+    appendValue(&numberOfChargeRasterValues, sizeof(numberOfChargeRasterValues));
+    appendValue(param.ChargeRaster.data(), sizeof(double) * param.ChargeRaster.size());
+    appendValue(param.HBClassElmnt.data(), sizeof(int) * param.HBClassElmnt.size());
+
+    return key;
+}
+
+static std::string getSegmentProfileCacheKey(parameters& param, const molecule& _molecule) {
+
+    std::string key = getSegmentProfileSettingsKey(param);
+    auto appendValue = [&](const void* value, size_t size) {
+        key.append(reinterpret_cast<const char*>(value), size);
+    };
+
+    uint64_t numberOfSegments = _molecule.segmentAreas.size();
+    appendValue(&numberOfSegments, sizeof(numberOfSegments));
+    appendValue(&_molecule.moleculeCharge, sizeof(_molecule.moleculeCharge));
+    appendValue(&_molecule.moleculeGroup, sizeof(_molecule.moleculeGroup));
+
+    uint64_t segmentDataHash = calculateContentHash(reinterpret_cast<const char*>(_molecule.segmentPositions.data()), sizeof(double) * _molecule.segmentPositions.size());
+    segmentDataHash = calculateContentHash(reinterpret_cast<const char*>(_molecule.segmentAreas.data()), sizeof(double) * _molecule.segmentAreas.size(), segmentDataHash);
+    segmentDataHash = calculateContentHash(reinterpret_cast<const char*>(_molecule.segmentSigmas.data()), sizeof(double) * _molecule.segmentSigmas.size(), segmentDataHash);
+    segmentDataHash = calculateContentHash(reinterpret_cast<const char*>(_molecule.segmentAtomicNumber.data()), sizeof(int) * _molecule.segmentAtomicNumber.size(), segmentDataHash);
+    appendValue(&segmentDataHash, sizeof(segmentDataHash));
+
+    // the estimated molar volume is stored in the header and also depends on the atoms and the area
+    int32_t molarVolumeIsEstimated = param.dGsolv_E_gas.size() > 0 || param.sw_estimateMolarVolume == 1;
+    appendValue(&molarVolumeIsEstimated, sizeof(molarVolumeIsEstimated));
+    if (molarVolumeIsEstimated) {
+        uint64_t numberOfAtoms = _molecule.atomAtomicNumbers.size();
+        appendValue(&numberOfAtoms, sizeof(numberOfAtoms));
+        appendValue(&_molecule.Area, sizeof(_molecule.Area));
+        uint64_t atomDataHash = calculateContentHash(reinterpret_cast<const char*>(_molecule.atomAtomicNumbers.data()), sizeof(int) * _molecule.atomAtomicNumbers.size());
+        appendValue(&atomDataHash, sizeof(atomDataHash));
+    }
+
+    key.resize(roundUpToMultipleOfEightBytes(key.size()), '\0');
+    return key;
+}
+
+// identifies the settings the segment types of extended sigma profiles were calculated with
+uint64_t getSegmentProfileSettingsHash(parameters& param) {
+    std::string key = getSegmentProfileSettingsKey(param);
+    return calculateContentHash(key.data(), key.size());
+}
+
+static std::string getSegmentProfileCacheFilePath(parameters& param, const std::string& key) {
+    return getCacheFilePath(param, key, ".ocrsprf");
+}
+
+struct segmentProfileCacheHeader {
+    uint64_t keyLength;
+    uint64_t numberOfSegmentTypes;
+
+    double maximumSigmaAveragingDeviation;
+    int64_t numberOfSegmentTypesOnFullSigmaGrid;
+    double relativeSecondSigmaMomentDeviation;
+    double molarVolumeAt25C;
+};
+
+// returns true and sets the segment types of the molecule if a cache file with the same key exists
+bool readSegmentProfileFromCache(parameters& param, molecule& _molecule) {
+
+    std::string key = getSegmentProfileCacheKey(param, _molecule);
+    memoryMappedFile cacheFile(getSegmentProfileCacheFilePath(param, key));
+    if (!cacheFile.isOpen())
+        return false;
+
+    const char* data = cacheFile.begin();
+    size_t size = size_t(cacheFile.end() - cacheFile.begin());
+
+    segmentProfileCacheHeader header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+
+    // the areas as doubles, the sigmas as floats and the group, HB type and atomic number as unsigned shorts
+    size_t numberOfSegmentTypes = size_t(header.numberOfSegmentTypes);
+    size_t expectedSize = sizeof(header) + roundUpToMultipleOfEightBytes(header.keyLength)
+        + sizeof(double) * numberOfSegmentTypes
+        + roundUpToMultipleOfEightBytes(2 * sizeof(float) * numberOfSegmentTypes)
+        + roundUpToMultipleOfEightBytes(3 * sizeof(unsigned short) * numberOfSegmentTypes);
+    if (size != expectedSize || header.keyLength != key.size() || memcmp(data + sizeof(header), key.data(), key.size()) != 0)
+        return false;
+
+    const char* position = data + sizeof(header) + key.size();
+    auto readValues = [&](void* destination, size_t sizeOfValues) {
+        memcpy(destination, position, sizeOfValues);
+        position += sizeOfValues;
+    };
+
+    segmentTypeCollection& segments = _molecule.segments;
+    segments.clear();
+    segments.SegmentTypeAreas.resize(numberOfSegmentTypes, 1);
+    segments.SegmentTypeSigma.resize(numberOfSegmentTypes);
+    segments.SegmentTypeSigmaCorr.resize(numberOfSegmentTypes);
+    segments.SegmentTypeGroup.resize(numberOfSegmentTypes);
+    segments.SegmentTypeHBtype.resize(numberOfSegmentTypes);
+    segments.SegmentTypeAtomicNumber.resize(numberOfSegmentTypes);
+
+    readValues(segments.SegmentTypeAreas.data(), sizeof(double) * numberOfSegmentTypes);
+    readValues(segments.SegmentTypeSigma.data(), sizeof(float) * numberOfSegmentTypes);
+    readValues(segments.SegmentTypeSigmaCorr.data(), sizeof(float) * numberOfSegmentTypes);
+    position = data + size - roundUpToMultipleOfEightBytes(3 * sizeof(unsigned short) * numberOfSegmentTypes);
+    readValues(segments.SegmentTypeGroup.data(), sizeof(unsigned short) * numberOfSegmentTypes);
+    readValues(segments.SegmentTypeHBtype.data(), sizeof(unsigned short) * numberOfSegmentTypes);
+    readValues(segments.SegmentTypeAtomicNumber.data(), sizeof(unsigned short) * numberOfSegmentTypes);
+
+    segments.updateGroupBounds();
+
+    _molecule.maximumSigmaAveragingDeviation = header.maximumSigmaAveragingDeviation;
+    _molecule.numberOfSegmentTypesOnFullSigmaGrid = int(header.numberOfSegmentTypesOnFullSigmaGrid);
+    _molecule.relativeSecondSigmaMomentDeviation = header.relativeSecondSigmaMomentDeviation;
+    _molecule.molarVolumeAt25C = header.molarVolumeAt25C;
+
+    return true;
+}
+
+// writes the sorted segment types of the molecule, failing to write the cache is not an error
+void writeSegmentProfileToCache(parameters& param, molecule& _molecule) {
+
+    std::string key = getSegmentProfileCacheKey(param, _molecule);
+    segmentTypeCollection& segments = _molecule.segments;
+    size_t numberOfSegmentTypes = segments.size();
+
+    segmentProfileCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.keyLength = key.size();
+    header.numberOfSegmentTypes = numberOfSegmentTypes;
+    header.maximumSigmaAveragingDeviation = _molecule.maximumSigmaAveragingDeviation;
+    header.numberOfSegmentTypesOnFullSigmaGrid = _molecule.numberOfSegmentTypesOnFullSigmaGrid;
+    header.relativeSecondSigmaMomentDeviation = _molecule.relativeSecondSigmaMomentDeviation;
+    header.molarVolumeAt25C = _molecule.molarVolumeAt25C;
+
+    std::string content(reinterpret_cast<const char*>(&header), sizeof(header));
+    content += key;
+
+    auto appendValues = [&](const void* values, size_t sizeOfValues) {
+        content.append(reinterpret_cast<const char*>(values), sizeOfValues);
+    };
+
+    appendValues(segments.SegmentTypeAreas.data(), sizeof(double) * numberOfSegmentTypes);
+    appendValues(segments.SegmentTypeSigma.data(), sizeof(float) * numberOfSegmentTypes);
+    appendValues(segments.SegmentTypeSigmaCorr.data(), sizeof(float) * numberOfSegmentTypes);
+    content.resize(roundUpToMultipleOfEightBytes(content.size()), '\0');
+    appendValues(segments.SegmentTypeGroup.data(), sizeof(unsigned short) * numberOfSegmentTypes);
+    appendValues(segments.SegmentTypeHBtype.data(), sizeof(unsigned short) * numberOfSegmentTypes);
+    appendValues(segments.SegmentTypeAtomicNumber.data(), sizeof(unsigned short) * numberOfSegmentTypes);
+    content.resize(roundUpToMultipleOfEightBytes(content.size()), '\0');
+
+    writeCacheFile(getSegmentProfileCacheFilePath(param, key), content);
+}
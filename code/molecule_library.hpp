@@ -0,0 +1,241 @@
+/*
+    c++ implementation of openCOSMO-RS including multiple segment descriptors
+    @author: Simon Mueller, 2022
+*/
+
+
+#pragma once
+#include "molecule_cache.hpp"
+#include <algorithm>
+#include <numeric>
+
+// Single file holding the records of many parsed molecules with an index sorted by name.
+// After the header follow the COSMOfile type the molecules were parsed from, the molecule records,
+// the index entries and the names of the index entries, each part padded to eight bytes.
+// The file is mapped into memory and only the records of the requested molecules are read.
+
+const char moleculeLibraryMagic[8] = { 'O', 'C', 'R', 'S', 'L', 'I', 'B', '\0' };
+const uint32_t moleculeLibraryVersion = 1;
+
+struct moleculeLibraryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sizeOfDouble;
+
+    uint64_t numberOfMolecules;
+    uint64_t indexOffset;
+    uint64_t COSMOfileTypeLength;
+};
+
+struct moleculeLibraryIndexEntry {
+    uint64_t nameOffset;
+    uint64_t nameLength;
+    uint64_t recordOffset;
+    uint64_t recordSize;
+};
+
+class moleculeLibrary {
+
+    memoryMappedFile libraryFile;
+    std::string libraryPath;
+    size_t numberOfMolecules = 0;
+    const char* indexEntries = nullptr;
+
+    moleculeLibraryIndexEntry getIndexEntry(size_t i) const {
+        moleculeLibraryIndexEntry entry;
+        memcpy(&entry, indexEntries + i * sizeof(entry), sizeof(entry));
+        return entry;
+    }
+
+    // written so that corrupted offsets and lengths can not overflow
+    bool isInsideFile(uint64_t offset, uint64_t length) const {
+        uint64_t size = uint64_t(libraryFile.end() - libraryFile.begin());
+        return offset <= size && length <= size - offset;
+    }
+
+    std::string getName(const moleculeLibraryIndexEntry& entry) const {
+        if (!isInsideFile(entry.nameOffset, entry.nameLength))
+            throw std::runtime_error("The index of the molecule library " + libraryPath + " is corrupted.");
+        return std::string(libraryFile.begin() + entry.nameOffset, size_t(entry.nameLength));
+    }
+
+    // binary search on the sorted index, returns false if the molecule is not in the library
+    bool findIndexEntry(const std::string& moleculeName, moleculeLibraryIndexEntry& entry) const {
+        size_t lower = 0;
+        size_t upper = numberOfMolecules;
+        while (lower < upper) {
+            size_t middle = lower + (upper - lower) / 2;
+            entry = getIndexEntry(middle);
+            int comparison = getName(entry).compare(moleculeName);
+            if (comparison == 0)
+                return true;
+            if (comparison < 0)
+                lower = middle + 1;
+            else
+                upper = middle;
+        }
+        return false;
+    }
+
+public:
+    std::string COSMOfileType;
+
+    moleculeLibrary(const std::string& path) : libraryFile(path), libraryPath(path) {
+
+        if (!libraryFile.isOpen())
+            throw std::runtime_error("The molecule library could not be opened: " + path);
+
+        size_t size = size_t(libraryFile.end() - libraryFile.begin());
+        moleculeLibraryHeader header;
+        if (size < sizeof(header))
+            throw std::runtime_error("The file is not a molecule library: " + path);
+        memcpy(&header, libraryFile.begin(), sizeof(header));
+
+        if (memcmp(header.magic, moleculeLibraryMagic, sizeof(moleculeLibraryMagic)) != 0)
+            throw std::runtime_error("The file is not a molecule library: " + path);
+        if (header.version != moleculeLibraryVersion || header.sizeOfDouble != sizeof(double))
+            throw std::runtime_error("The molecule library was created with an incompatible version, please create it again: " + path);
+        if (header.indexOffset > size || (size - header.indexOffset) / sizeof(moleculeLibraryIndexEntry) < header.numberOfMolecules)
+            throw std::runtime_error("The molecule library is incomplete: " + path);
+        if (!isInsideFile(sizeof(header), header.COSMOfileTypeLength))
+            throw std::runtime_error("The molecule library is incomplete: " + path);
+
+        COSMOfileType = std::string(libraryFile.begin() + sizeof(header), size_t(header.COSMOfileTypeLength));
+        numberOfMolecules = size_t(header.numberOfMolecules);
+        indexEntries = libraryFile.begin() + header.indexOffset;
+    }
+
+    moleculeLibrary(const moleculeLibrary&) = delete;
+    moleculeLibrary& operator=(const moleculeLibrary&) = delete;
+
+    size_t size() const {
+        return numberOfMolecules;
+    }
+
+    bool contains(const std::string& moleculeName) const {
+        moleculeLibraryIndexEntry entry;
+        return findIndexEntry(moleculeName, entry);
+    }
+
+    // fills the molecule as it was after parsing its COSMOfile
+    void readMolecule(const std::string& moleculeName, molecule& parsedMolecule) const {
+
+        moleculeLibraryIndexEntry entry;
+        if (!findIndexEntry(moleculeName, entry))
+            throw std::runtime_error("The molecule " + moleculeName + " was not found in the molecule library " + libraryPath);
+
+        if (!isInsideFile(entry.recordOffset, entry.recordSize) || !readMoleculeRecord(libraryFile.begin() + entry.recordOffset, size_t(entry.recordSize), parsedMolecule))
+            throw std::runtime_error("The record of the molecule " + moleculeName + " in the molecule library " + libraryPath + " is corrupted.");
+    }
+};
+
+// writes the molecule records one after the other, the index is written by finish.
+// The library is written to a temporary file which replaces the library when finished.
+class moleculeLibraryWriter {
+
+    std::string libraryPath;
+    std::string temporaryFilePath;
+    FILE* temporaryFile = NULL;
+    uint64_t position = 0;
+
+    std::vector<std::string> names;
+    std::vector<moleculeLibraryIndexEntry> indexEntries;
+    moleculeLibraryHeader header;
+
+    void write(const std::string& content) {
+        if (fwrite(content.data(), 1, content.size(), temporaryFile) != content.size())
+            throw std::runtime_error("The molecule library could not be written: " + libraryPath);
+        position += content.size();
+    }
+
+public:
+    moleculeLibraryWriter(const std::string& path, const std::string& COSMOfileType) : libraryPath(path) {
+
+        temporaryFilePath = path + ".tmp";
+        temporaryFile = fopen(temporaryFilePath.c_str(), "wb");
+        if (temporaryFile == NULL)
+            throw std::runtime_error("The molecule library could not be created: " + path);
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, moleculeLibraryMagic, sizeof(moleculeLibraryMagic));
+        header.version = moleculeLibraryVersion;
+        header.sizeOfDouble = sizeof(double);
+        header.COSMOfileTypeLength = COSMOfileType.size();
+
+        // the header is written again with the index offset when finished
+        std::string content(reinterpret_cast<const char*>(&header), sizeof(header));
+        content += COSMOfileType;
+        content.resize(roundUpToMultipleOfEightBytes(content.size()), '\0');
+        write(content);
+    }
+
+    ~moleculeLibraryWriter() {
+        if (temporaryFile != NULL) {
+            fclose(temporaryFile);
+            std::remove(temporaryFilePath.c_str());
+        }
+    }
+
+    moleculeLibraryWriter(const moleculeLibraryWriter&) = delete;
+    moleculeLibraryWriter& operator=(const moleculeLibraryWriter&) = delete;
+
+    void add(const molecule& parsedMolecule) {
+
+        std::string record;
+        appendMoleculeRecord(record, parsedMolecule);
+
+        moleculeLibraryIndexEntry entry;
+        entry.nameOffset = 0;
+        entry.nameLength = parsedMolecule.name.size();
+        entry.recordOffset = position;
+        entry.recordSize = record.size();
+
+        write(record);
+        names.push_back(parsedMolecule.name);
+        indexEntries.push_back(entry);
+    }
+
+    void finish() {
+
+        std::vector<size_t> order(names.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t i, size_t j) { return names[i] < names[j]; });
+
+        for (size_t i = 1; i < order.size(); i++) {
+            if (names[order[i]] == names[order[i - 1]])
+                throw std::runtime_error("The molecule name " + names[order[i]] + " occurs more than once in the molecule library.");
+        }
+
+        header.numberOfMolecules = names.size();
+        header.indexOffset = position;
+
+        uint64_t nameOffset = position + names.size() * sizeof(moleculeLibraryIndexEntry);
+        std::string index;
+        std::string sortedNames;
+        for (size_t i : order) {
+            moleculeLibraryIndexEntry entry = indexEntries[i];
+            entry.nameOffset = nameOffset + sortedNames.size();
+            index.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+            sortedNames += names[i];
+        }
+        sortedNames.resize(roundUpToMultipleOfEightBytes(sortedNames.size()), '\0');
+        write(index);
+        write(sortedNames);
+
+        if (fseek(temporaryFile, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), temporaryFile) != sizeof(header))
+            throw std::runtime_error("The molecule library could not be written: " + libraryPath);
+
+        bool closed = fclose(temporaryFile) == 0;
+        temporaryFile = NULL;
+
+#if defined(_WIN32)
+        // on Windows rename does not replace existing files
+        if (closed)
+            std::remove(libraryPath.c_str());
+#endif
+        if (closed == false || std::rename(temporaryFilePath.c_str(), libraryPath.c_str()) != 0) {
+            std::remove(temporaryFilePath.c_str());
+            throw std::runtime_error("The molecule library could not be written: " + libraryPath);
+        }
+    }
+};
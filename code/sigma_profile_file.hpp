@@ -0,0 +1,162 @@
+/*
+    c++ implementation of openCOSMO-RS including multiple segment descriptors
+    @author: Simon Mueller, 2022
+*/
+
+
+#pragma once
+#include "molecule_cache.hpp"
+
+// Single file holding the sigma profiles of many molecules as descriptors, e.g. for machine learning.
+// After the header follow the records of the molecules in the order of their component paths. Every record starts
+// with a sigmaProfileRecordHeader followed by the name and the qmMethod and the segment types of the molecule
+// in the layout of segmentProfile, each part padded to eight bytes. recordSize allows to skip to the next record.
+
+const char sigmaProfileFileMagic[8] = { 'O', 'C', 'R', 'S', 'S', 'P', 'F', '\0' };
+const uint32_t sigmaProfileFileVersion = 1;
+
+struct sigmaProfileFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sizeOfDouble;
+
+    uint64_t numberOfMolecules;
+    uint64_t settingsHash; // getSegmentProfileSettingsHash of the settings the segment types were calculated with
+    double SigmaHB;
+};
+
+// the sigma moments are calculated from the segment types with sigma in e/Angstrom^2 and the areas in Angstrom^2:
+// M0 to M4 are the sums of area * sigma^i, the HB moments the sums of area * max(0, sigma - SigmaHB) for acceptors
+// and of area * max(0, -sigma - SigmaHB) for donors
+const int numberOfSigmaMoments = 7;
+
+struct sigmaProfileRecordHeader {
+    uint64_t recordSize;
+    uint64_t nameLength;
+    uint64_t qmMethodLength;
+    uint64_t numberOfSegmentTypes;
+
+    double Area;
+    double Volume;
+    double molarVolumeAt25C; // QSPR estimate, only set if the molar volume was estimated
+
+    int32_t moleculeCharge;
+    uint32_t moleculeGroup;
+
+    double sigmaMoments[numberOfSigmaMoments]; // M0, M1, M2, M3, M4, HB acceptor moment, HB donor moment
+};
+
+void calculateSigmaMoments(const segmentProfile& profile, double SigmaHB, double* sigmaMoments) {
+
+    for (int i = 0; i < numberOfSigmaMoments; i++) {
+        sigmaMoments[i] = 0;
+    }
+
+    for (size_t i = 0; i < profile.size(); i++) {
+        double area = profile.areas()[i];
+        double sigma = profile.sigmas()[i];
+
+        double sigmaPower = 1;
+        for (int j = 0; j < 5; j++) {
+            sigmaMoments[j] += area * sigmaPower;
+            sigmaPower *= sigma;
+        }
+        sigmaMoments[5] += area * std::max(0.0, sigma - SigmaHB);
+        sigmaMoments[6] += area * std::max(0.0, -sigma - SigmaHB);
+    }
+}
+
+void appendSigmaProfileRecord(std::string& content, const molecule& _molecule, double SigmaHB) {
+
+    size_t recordStart = content.size();
+
+    sigmaProfileRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.nameLength = _molecule.name.size();
+    header.qmMethodLength = _molecule.qmMethod.size();
+    header.numberOfSegmentTypes = _molecule.profile.size();
+    header.Area = _molecule.Area;
+    header.Volume = _molecule.Volume;
+    header.molarVolumeAt25C = _molecule.molarVolumeAt25C;
+    header.moleculeCharge = _molecule.moleculeCharge;
+    header.moleculeGroup = _molecule.moleculeGroup;
+    calculateSigmaMoments(_molecule.profile, SigmaHB, header.sigmaMoments);
+
+    content.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    content += _molecule.name + _molecule.qmMethod;
+    content.resize(roundUpToMultipleOfEightBytes(content.size()), '\0');
+    content.append(_molecule.profile.data(), _molecule.profile.sizeInBytes());
+    content.resize(roundUpToMultipleOfEightBytes(content.size()), '\0');
+
+    header.recordSize = content.size() - recordStart;
+    memcpy(&content[recordStart], &header.recordSize, sizeof(header.recordSize));
+}
+
+// writes the records one after the other, the number of molecules is written by finish.
+// The file is written to a temporary file which replaces the sigma profile file when finished.
+class sigmaProfileFileWriter {
+
+    std::string filePath;
+    std::string temporaryFilePath;
+    FILE* temporaryFile = NULL;
+    sigmaProfileFileHeader header;
+
+    void write(const std::string& content) {
+        if (fwrite(content.data(), 1, content.size(), temporaryFile) != content.size())
+            throw std::runtime_error("The sigma profile file could not be written: " + filePath);
+    }
+
+public:
+    sigmaProfileFileWriter(const std::string& path, uint64_t settingsHash, double SigmaHB) : filePath(path) {
+
+        temporaryFilePath = path + ".tmp";
+        temporaryFile = fopen(temporaryFilePath.c_str(), "wb");
+        if (temporaryFile == NULL)
+            throw std::runtime_error("The sigma profile file could not be created: " + path);
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, sigmaProfileFileMagic, sizeof(sigmaProfileFileMagic));
+        header.version = sigmaProfileFileVersion;
+        header.sizeOfDouble = sizeof(double);
+        header.settingsHash = settingsHash;
+        header.SigmaHB = SigmaHB;
+
+        // the header is written again with the number of molecules when finished
+        write(std::string(reinterpret_cast<const char*>(&header), sizeof(header)));
+    }
+
+    ~sigmaProfileFileWriter() {
+        if (temporaryFile != NULL) {
+            fclose(temporaryFile);
+            std::remove(temporaryFilePath.c_str());
+        }
+    }
+
+    sigmaProfileFileWriter(const sigmaProfileFileWriter&) = delete;
+    sigmaProfileFileWriter& operator=(const sigmaProfileFileWriter&) = delete;
+
+    // adds records created with appendSigmaProfileRecord
+    void add(const std::string& records, uint64_t numberOfRecords) {
+        write(records);
+        header.numberOfMolecules += numberOfRecords;
+    }
+
+    void finish() {
+
+        if (fseek(temporaryFile, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), temporaryFile) != sizeof(header))
+            throw std::runtime_error("The sigma profile file could not be written: " + filePath);
+
+        bool closed = fclose(temporaryFile) == 0;
+        temporaryFile = NULL;
+
+#if defined(_WIN32)
+        // on Windows rename does not replace existing files
+        if (closed)
+            std::remove(filePath.c_str());
+#endif
+        if (closed == false || std::rename(temporaryFilePath.c_str(), filePath.c_str()) != 0) {
+            std::remove(temporaryFilePath.c_str());
+            throw std::runtime_error("The sigma profile file could not be written: " + filePath);
+        }
+    }
+};
@@ -14,6 +14,9 @@
 #include <memory>
 #include <algorithm>
 #include <mutex>
+#include <map>
+#include <tuple>
+#include <cstring>
 
 // always include this as at least SSE3 is required
 #include <immintrin.h>
@@ -68,12 +71,38 @@ struct parameters {
 
 	std::string sw_COSMOfiles_type = "ORCA_COSMO_TZVPD"; // Type of COSMOfile used, this is used to know which function to use to load the sigma profile. e.g. Turbomole
 
+	std::string sw_moleculeCacheDirectory = "";	/* existing directory in which the parsed COSMOfiles are cached as binary files to skip parsing
+													   them on later runs. "" deactivates the cache.
+													   The averaged and clustered segment types are cached there as well, keyed by the settings they depend on,
+													   together with the estimated molar volume */
+
+	std::string sw_moleculeLibraryPath = "";	/* molecule library created with createMoleculeLibrary. If set, the molecules are loaded from the library
+												   and the component paths are the names of the molecules in the library, i.e. their COSMOfile names without extension */
+
+	std::string sw_extendedSigmaProfileDirectory = "";	/* existing directory into which the extended sigma profile (.extsp) of every molecule loaded from a COSMOfile
+															   is written. Component paths ending in .extsp are read as extended sigma profiles instead of COSMOfiles,
+															   they have to be calculated with the same settings as used for reading them */
+
+	int sw_deduplicateMolecules = 1;	/* switch: "0" every component path is loaded as its own molecule
+											   "1" component paths with the same content, e.g. copies of one COSMOfile, share one molecule
+											       which is averaged and clustered once, the shared paths are displayed */
+
+	int sw_loadMoleculesOnDemand = 0;	/* switch: "0" all molecules of the component paths are loaded by loadMolecules
+											   "1" a molecule is loaded when the first calculation referring to it is loaded,
+											       COSMOfiles not referred to by any calculation are never opened */
+
 	int sw_calculateContactStatisticsAndAdditionalProperties = 0;		/* switch:  "0" Do not calculate contact statistics
 																				"1" Calculate contact statistics 
 																				"2" Calculate contact statistics, partial molar properties and average surface energies*/
 	int numberOfPartialInteractionMatrices;
 
-	int sw_alwaysReloadSigmaProfiles = 0;
+	int sw_alwaysReloadSigmaProfiles = 0;	/* switch: "1" the sigma profiles are averaged and clustered again in every call to allow fitting Rav and RavCorr.
+												   With sw_sigmaAveragingWeightCutoff the segment distances needed for the averaging are kept
+												   per molecule and reused while possible */
+
+	int sw_singlePrecisionSegmentDistances = 0;	/* switch: "0" the segment distances kept with sw_alwaysReloadSigmaProfiles are stored in double precision
+													   "1" they are stored in single precision, which halves the memory of large molecule sets
+													       while changing the averaged sigmas only in the order of the float precision */
 
 	int sw_reloadConcentrations = 0;
 	int sw_reloadReferenceConcentrations = 0;
@@ -84,6 +113,25 @@ struct parameters {
 	int sw_skip_COSMOSPACE_errors = 0;	/* switch: "0" if COSMOSPACE does not converge, it stops execution showing DEBUG information
 											   "1" if COSMOSPACE does not converge, execution continues setting the objective function very high */
 
+	int sw_reuseSolvedStates = 1;		/* switch: "0" every concentration of every calculation is solved on its own
+											   "1" states occuring more than once during a call of calculate, e.g. pure component reference states,
+											       are only solved once, this is not used when calculating contact statistics */
+
+	double sw_sigmaAveragingWeightCutoff = 0;	/* gaussian weights of the sigma averaging smaller than this value times their prefactor are neglected
+												   using a neighbor search on a grid of cells. "0" averages over all segment pairs.
+												   An upper bound of the deviation from the exact sum is displayed after loading */
+
+	int sw_sigmaGridCoarseningFactor = 1;	/* multiple of sigmaStep used to cluster the segments into segment types, has to divide the number of sigma steps.
+											   Values larger than 1 reduce the number of segment types at the cost of accuracy,
+											   e.g. for first screenings. The reduction and an error estimate are displayed after loading */
+
+	int sw_mergeEquivalentSegmentTypes = 1;	/* switch: "0" segment types of a calculation are kept as they are on the molecules
+												   "1" segment types of neutral groups that are not distinguishable in the interaction matrix
+												       (atomic number, group and HB type on the wrong side of sigma = 0) are merged for the calculation */
+
+	int sw_estimateMolarVolume = 0;	/* switch: "1" the molar volume at 25 degC is estimated with its QSPR model also if no solvation energies are calculated,
+										   e.g. for the sigma profile file */
+
 	int sw_dGsolv_calculation_strict = 1; // 0Allows calculation of solvation free energies also for atoms that have not been parameterized, but gives a warning
 										  // 1: Allows calculation of solvation free energies if all parameters are available
     /* COSMO-RS MODEL PARAMETERS */
@@ -135,7 +183,56 @@ struct parameters {
 struct segmentTypeCollection {
 
 private:
-	std::vector<double> SegmentTypeAreasRowTemplate;
+
+	// the descriptors of a segment type packed into two integers, the sigmas with their exact bits
+	// so that the index finds the same segment types as comparing with ==
+	struct segmentTypeKey {
+		uint64_t sigmas;
+		uint64_t identifiers;
+
+		segmentTypeKey(unsigned short group, float Sigma, float SigmaCorr, unsigned short HBtype, unsigned short atomicNumber) {
+			// -0.0f == 0.0f has to result in the same key
+			uint32_t sigmaBits = floatToBits(Sigma == 0.0f ? 0.0f : Sigma);
+			uint32_t sigmaCorrBits = floatToBits(SigmaCorr == 0.0f ? 0.0f : SigmaCorr);
+			sigmas = (uint64_t(sigmaBits) << 32) | sigmaCorrBits;
+			identifiers = (uint64_t(group) << 32) | (uint64_t(HBtype) << 16) | atomicNumber;
+		}
+
+		static uint32_t floatToBits(float value) {
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		bool operator==(const segmentTypeKey& other) const {
+			return sigmas == other.sigmas && identifiers == other.identifiers;
+		}
+	};
+
+	struct segmentTypeKeyHash {
+		size_t operator()(const segmentTypeKey& key) const {
+			size_t hash = std::hash<uint64_t>()(key.sigmas);
+			hash ^= std::hash<uint64_t>()(key.identifiers) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			return hash;
+		}
+	};
+
+	// index of the segment types, segment types added or changed without add are indexed on the next call to add
+	std::unordered_map<segmentTypeKey, int, segmentTypeKeyHash> segmentTypeIndex;
+	size_t numberOfIndexedSegmentTypes = 0;
+
+	void reserveAreaRows(int numberOfRows) {
+		Eigen::Index previousNumberOfRows = SegmentTypeAreas.rows();
+		if (numberOfRows > previousNumberOfRows) {
+			SegmentTypeAreas.conservativeResize(numberOfRows, Eigen::NoChange);
+			SegmentTypeAreas.bottomRows(numberOfRows - previousNumberOfRows).setZero();
+		}
+	}
+
+	void clearSegmentTypeIndex() {
+		segmentTypeIndex = std::unordered_map<segmentTypeKey, int, segmentTypeKeyHash>();
+		numberOfIndexedSegmentTypes = 0;
+	}
 
 	std::vector<int> get_permutation_vector()
 	{
@@ -144,20 +241,10 @@ private:
 		std::sort(p.begin(), p.end(),
 			[&](int i, int j) {
 
-			if (SegmentTypeGroup[i] != SegmentTypeGroup[j]) { return SegmentTypeGroup[i] < SegmentTypeGroup[j]; }
-
-			// if both segments belong to an monoatomic ion, first sort by atomic number
-			if (SegmentTypeGroup[i] == 3 || SegmentTypeGroup[i] == 5) {
-				if (SegmentTypeAtomicNumber[i] != SegmentTypeAtomicNumber[j]) { return SegmentTypeAtomicNumber[i] < SegmentTypeAtomicNumber[j]; }
-			}
-
-			if (SegmentTypeSigma[i] != SegmentTypeSigma[j]) { return SegmentTypeSigma[i] < SegmentTypeSigma[j]; }
-
-			if (SegmentTypeSigmaCorr[i] != SegmentTypeSigmaCorr[j]) { return SegmentTypeSigmaCorr[i] < SegmentTypeSigmaCorr[j]; }
+			int comparison = compareSegmentTypes(SegmentTypeGroup[i], SegmentTypeSigma[i], SegmentTypeSigmaCorr[i], SegmentTypeHBtype[i], SegmentTypeAtomicNumber[i],
+				SegmentTypeGroup[j], SegmentTypeSigma[j], SegmentTypeSigmaCorr[j], SegmentTypeHBtype[j], SegmentTypeAtomicNumber[j]);
 
-			if (SegmentTypeHBtype[i] != SegmentTypeHBtype[j]) { return SegmentTypeHBtype[i] < SegmentTypeHBtype[j]; }
-
-			if (SegmentTypeAtomicNumber[i] != SegmentTypeAtomicNumber[j]) { return SegmentTypeAtomicNumber[i] < SegmentTypeAtomicNumber[j]; }
+			if (comparison != 0) { return comparison < 0; }
 
 			return i < j;
 
@@ -172,19 +259,16 @@ public:
 	int upperBoundIndexForGroup[7] = { 0 };
 	int numberOfSegmentsForGroup[7] = { 0 };
 
-	segmentTypeCollection() {
-		segmentTypeCollection(1);
+	segmentTypeCollection() : segmentTypeCollection(1) {
 	}
 
 	segmentTypeCollection(int numberOfMolecules) {
-		
-		for (int i = 0; i < numberOfMolecules; i++) {
-			SegmentTypeAreasRowTemplate.push_back(0.0);
-		}
-		SegmentTypeAreasRowTemplate.shrink_to_fit();
+		SegmentTypeAreas = Eigen::MatrixXd::Zero(0, numberOfMolecules);
 	}
 
-	std::vector<std::vector<double>> SegmentTypeAreas;
+	// areas of the segment types [segment type x molecule], stored column-major so that the areas of one molecule are contiguous.
+	// While segment types are added the matrix can have more rows than segment types, these rows are zero.
+	Eigen::MatrixXd SegmentTypeAreas;
 	std::vector<unsigned short> SegmentTypeGroup;
 	std::vector<float> SegmentTypeSigma;
 	std::vector<float> SegmentTypeSigmaCorr;
@@ -193,17 +277,19 @@ public:
 
 	void clear() {
 
-		SegmentTypeAreas.clear();
+		SegmentTypeAreas.resize(0, SegmentTypeAreas.cols());
 		SegmentTypeGroup.clear();
 		SegmentTypeSigma.clear();
 		SegmentTypeSigmaCorr.clear();
 		SegmentTypeHBtype.clear();
 		SegmentTypeAtomicNumber.clear();
+
+		clearSegmentTypeIndex();
 	}
 
 	void reserve(int numberOfSegmentsTypes) {
 
-		SegmentTypeAreas.reserve(numberOfSegmentsTypes);
+		reserveAreaRows(numberOfSegmentsTypes);
 		SegmentTypeGroup.reserve(numberOfSegmentsTypes);
 		SegmentTypeSigma.reserve(numberOfSegmentsTypes);
 		SegmentTypeSigmaCorr.reserve(numberOfSegmentsTypes);
@@ -213,11 +299,8 @@ public:
 
 	void shrink_to_fit() {
 
-		for (int i = 0; i < SegmentTypeAreas.size(); i++) {
-			SegmentTypeAreas[i].shrink_to_fit();
-		}
-
-		SegmentTypeAreas.shrink_to_fit();
+		SegmentTypeAreas.conservativeResize(size(), Eigen::NoChange);
+		SegmentTypeGroup.shrink_to_fit();
 		SegmentTypeSigma.shrink_to_fit();
 		SegmentTypeSigmaCorr.shrink_to_fit();
 		SegmentTypeHBtype.shrink_to_fit();
@@ -228,22 +311,72 @@ public:
 		return SegmentTypeHBtype.size();
 	}
 
+	// canonical order of the segment types used by sort: "-1" if segment type A comes before B, "0" if equal, "1" if after
+	static int compareSegmentTypes(unsigned short groupA, float SigmaA, float SigmaCorrA, unsigned short HBtypeA, unsigned short atomicNumberA,
+		unsigned short groupB, float SigmaB, float SigmaCorrB, unsigned short HBtypeB, unsigned short atomicNumberB) {
+
+		if (groupA != groupB) { return groupA < groupB ? -1 : 1; }
+
+		// if both segments belong to an monoatomic ion, first sort by atomic number
+		if (groupA == 3 || groupA == 5) {
+			if (atomicNumberA != atomicNumberB) { return atomicNumberA < atomicNumberB ? -1 : 1; }
+		}
+
+		if (SigmaA != SigmaB) { return SigmaA < SigmaB ? -1 : 1; }
+
+		if (SigmaCorrA != SigmaCorrB) { return SigmaCorrA < SigmaCorrB ? -1 : 1; }
+
+		if (HBtypeA != HBtypeB) { return HBtypeA < HBtypeB ? -1 : 1; }
+
+		if (atomicNumberA != atomicNumberB) { return atomicNumberA < atomicNumberB ? -1 : 1; }
+
+		return 0;
+	}
+
+	// appends a segment type that does not come before the last one in the canonical order, equal segment types are merged.
+	// This builds a sorted collection without search and sort, updateGroupBounds has to be called afterwards.
+	void appendInOrder(unsigned short ind_molecule, unsigned short group, float Sigma, float SigmaCorr, unsigned short HBtype, unsigned short atomicNumber, double Area) {
+
+		if (Area == 0) {
+			return;
+		}
+
+		int index = int(size()) - 1;
+
+		if (index == -1 || compareSegmentTypes(SegmentTypeGroup[index], SegmentTypeSigma[index], SegmentTypeSigmaCorr[index], SegmentTypeHBtype[index], SegmentTypeAtomicNumber[index],
+			group, Sigma, SigmaCorr, HBtype, atomicNumber) != 0) {
+
+			SegmentTypeGroup.push_back(group);
+			SegmentTypeHBtype.push_back(HBtype);
+			SegmentTypeSigma.push_back(Sigma);
+			SegmentTypeSigmaCorr.push_back(SigmaCorr);
+			SegmentTypeAtomicNumber.push_back(atomicNumber);
+
+			index = (int)SegmentTypeHBtype.size() - 1;
+			if (index >= SegmentTypeAreas.rows()) {
+				reserveAreaRows(std::max(2 * int(SegmentTypeAreas.rows()), 8));
+			}
+		}
+
+		SegmentTypeAreas(index, ind_molecule) += Area;
+	}
+
 	void add(unsigned short ind_molecule, unsigned short group, float Sigma, float SigmaCorr, unsigned short HBtype, unsigned short atomicNumber, double Area) {
 
 		if (Area == 0) {
 			return;
 		}
 
+		for (; numberOfIndexedSegmentTypes < SegmentTypeHBtype.size(); numberOfIndexedSegmentTypes++) {
+			size_t i = numberOfIndexedSegmentTypes;
+			segmentTypeIndex.emplace(segmentTypeKey(SegmentTypeGroup[i], SegmentTypeSigma[i], SegmentTypeSigmaCorr[i], SegmentTypeHBtype[i], SegmentTypeAtomicNumber[i]), int(i));
+		}
+
 		int index = -1;
-		for (int i = 0; i < SegmentTypeHBtype.size(); i++) {
-			if (SegmentTypeGroup[i] == group &&
-				SegmentTypeHBtype[i] == HBtype &&
-				SegmentTypeSigma[i] == Sigma &&
-				SegmentTypeSigmaCorr[i] == SigmaCorr &&
-				SegmentTypeAtomicNumber[i] == atomicNumber) {
-				index = i;
-				break;
-			}
+		segmentTypeKey key(group, Sigma, SigmaCorr, HBtype, atomicNumber);
+		auto it = segmentTypeIndex.find(key);
+		if (it != segmentTypeIndex.end()) {
+			index = it->second;
 		}
 
 		if (index == -1) {
@@ -254,10 +387,15 @@ public:
 			SegmentTypeAtomicNumber.push_back(atomicNumber);
 
 			index = (int)SegmentTypeHBtype.size() - 1;
-			SegmentTypeAreas.push_back(SegmentTypeAreasRowTemplate);
+			if (index >= SegmentTypeAreas.rows()) {
+				reserveAreaRows(std::max(2 * int(SegmentTypeAreas.rows()), 8));
+			}
+
+			segmentTypeIndex.emplace(key, index);
+			numberOfIndexedSegmentTypes++;
 		}
 
-		SegmentTypeAreas[index][ind_molecule] += Area;
+		SegmentTypeAreas(index, ind_molecule) += Area;
 	}
 
 	void sort() {
@@ -268,7 +406,20 @@ public:
 		apply_vector_permutation_in_place(SegmentTypeSigmaCorr, p);
 		apply_vector_permutation_in_place(SegmentTypeHBtype, p);
 		apply_vector_permutation_in_place(SegmentTypeAtomicNumber, p);
-		apply_vector_permutation_in_place(SegmentTypeAreas, p);
+
+		Eigen::MatrixXd sortedSegmentTypeAreas(p.size(), SegmentTypeAreas.cols());
+		for (int i = 0; i < p.size(); i++) {
+			sortedSegmentTypeAreas.row(i) = SegmentTypeAreas.row(p[i]);
+		}
+		SegmentTypeAreas.swap(sortedSegmentTypeAreas);
+
+		clearSegmentTypeIndex();
+
+		updateGroupBounds();
+	}
+
+	// sets the index ranges of the groups, the segment types have to be sorted
+	void updateGroupBounds() {
 
 		int temporaryindex = -1;
 		int i;
@@ -292,9 +443,195 @@ public:
 	}
 };
 
+// memory for the segment profiles of the molecules handed out from large blocks, so that the profiles of
+// many small molecules do not need allocations of their own. A block is freed when no profile uses it anymore.
+class segmentProfileArena {
+
+	std::mutex lock;
+	std::shared_ptr<char> block;
+	size_t bytesPerBlock;
+	size_t usedBytesOfBlock = 0;
+
+public:
+
+	segmentProfileArena(size_t _bytesPerBlock = 1 << 20) : bytesPerBlock(_bytesPerBlock) {
+	}
+
+	// the memory is aligned to eight bytes, the returned pointer shares the ownership of its block
+	std::shared_ptr<char> allocate(size_t numberOfBytes) {
+
+		numberOfBytes = (numberOfBytes + 7) & ~size_t(7);
+
+		// large profiles would waste the rest of a block
+		if (numberOfBytes > bytesPerBlock / 8) {
+			return std::shared_ptr<char>(new char[numberOfBytes], std::default_delete<char[]>());
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (block == nullptr || usedBytesOfBlock + numberOfBytes > bytesPerBlock) {
+			block = std::shared_ptr<char>(new char[bytesPerBlock], std::default_delete<char[]>());
+			usedBytesOfBlock = 0;
+		}
+
+		std::shared_ptr<char> memory(block, block.get() + usedBytesOfBlock);
+		usedBytesOfBlock += numberOfBytes;
+		return memory;
+	}
+
+	// the blocks in use stay alive until their profiles are destroyed
+	void clear() {
+		std::lock_guard<std::mutex> guard(lock);
+		block.reset();
+		usedBytesOfBlock = 0;
+	}
+};
+
+// immutable segment types of a finished molecule in the order of segmentTypeCollection::sort.
+// The descriptors are stored as contiguous arrays in one piece of memory of a segmentProfileArena:
+// areas (double), sigmas and sigmaCorrs (float), groups, HBtypes and atomicNumbers (unsigned short)
+struct segmentProfile {
+
+private:
+
+	std::shared_ptr<char> memory;
+	int numberOfSegmentTypes = 0;
+
+public:
+
+	static size_t bytesPerSegmentType() {
+		return sizeof(double) + 2 * sizeof(float) + 3 * sizeof(unsigned short);
+	}
+
+	size_t size() const {
+		return size_t(numberOfSegmentTypes);
+	}
+
+	// the arrays one after the other as described above
+	const char* data() const {
+		return memory.get();
+	}
+	size_t sizeInBytes() const {
+		return bytesPerSegmentType() * size();
+	}
+
+	const double* areas() const {
+		return reinterpret_cast<const double*>(memory.get());
+	}
+	const float* sigmas() const {
+		return reinterpret_cast<const float*>(memory.get() + sizeof(double) * size());
+	}
+	const float* sigmaCorrs() const {
+		return sigmas() + size();
+	}
+	const unsigned short* groups() const {
+		return reinterpret_cast<const unsigned short*>(sigmaCorrs() + size());
+	}
+	const unsigned short* HBtypes() const {
+		return groups() + size();
+	}
+	const unsigned short* atomicNumbers() const {
+		return HBtypes() + size();
+	}
+
+	// copies the sorted segment types of the first molecule of the collection
+	void assign(segmentTypeCollection& segments, segmentProfileArena& arena) {
+
+		numberOfSegmentTypes = int(segments.size());
+		memory = arena.allocate(std::max(size_t(1), bytesPerSegmentType() * size()));
+
+		char* position = memory.get();
+		auto append = [&](const void* source, size_t numberOfBytes) {
+			if (numberOfBytes > 0)
+				std::memcpy(position, source, numberOfBytes);
+			position += numberOfBytes;
+		};
+
+		append(segments.SegmentTypeAreas.col(0).data(), sizeof(double) * size());
+		append(segments.SegmentTypeSigma.data(), sizeof(float) * size());
+		append(segments.SegmentTypeSigmaCorr.data(), sizeof(float) * size());
+		append(segments.SegmentTypeGroup.data(), sizeof(unsigned short) * size());
+		append(segments.SegmentTypeHBtype.data(), sizeof(unsigned short) * size());
+		append(segments.SegmentTypeAtomicNumber.data(), sizeof(unsigned short) * size());
+	}
+
+	segmentTypeCollection toSegmentTypeCollection() const {
+
+		segmentTypeCollection segments(1);
+		segments.reserve(numberOfSegmentTypes);
+		for (int i = 0; i < numberOfSegmentTypes; i++) {
+			segments.appendInOrder(0, groups()[i], sigmas()[i], sigmaCorrs()[i], HBtypes()[i], atomicNumbers()[i], areas()[i]);
+		}
+		segments.shrink_to_fit();
+		segments.updateGroupBounds();
+		return segments;
+	}
+};
+
+// segments of a molecule sorted into cubic cells for the sigma averaging with their properties
+// stored as structure of arrays in cell order, so that the segments of a cell are contiguous
+struct sigmaAveragingGeometry {
+
+	double cellLength = -1; // "0" all segments are in one cell, negative if not built yet
+	Eigen::Vector3d lowerCorner = Eigen::Vector3d::Zero();
+	Eigen::Vector3i numberOfCells = Eigen::Vector3i::Ones();
+
+	std::vector<int> cellOfSegment;
+	std::vector<int> firstSegmentOfCell;
+	std::vector<int> segmentsInCells;
+	int maximumNumberOfSegmentsInCell = 0;
+
+	// the positions are not needed anymore once the squared distances are kept
+	Eigen::ArrayXd cellOrderedPositionsX;
+	Eigen::ArrayXd cellOrderedPositionsY;
+	Eigen::ArrayXd cellOrderedPositionsZ;
+	Eigen::ArrayXd cellOrderedSigmas;
+	Eigen::ArrayXd cellOrderedRadiiSquared;
+
+	// only kept if the sigma profiles are reloaded with a cutoff: the squared distances of every segment to the segments
+	// of the neighboring cells in the order of forEachNeighborCell, in single precision with sw_singlePrecisionSegmentDistances
+	std::vector<size_t> firstNeighborOfSegment;
+	Eigen::ArrayXd neighborSquaredDistances;
+	Eigen::ArrayXf singlePrecisionNeighborSquaredDistances;
+
+	// a geometry built with a larger cell length contains all needed neighbors
+	bool isUsableFor(double requiredCellLength) const {
+		if (cellLength < 0)
+			return false;
+		if (cellLength == 0)
+			return true;
+		return requiredCellLength > 0 && cellLength >= requiredCellLength;
+	}
+
+	// calls function(firstSegmentInCellOrder, numberOfSegmentsInCell) for the cell of the segment and all adjacent cells
+	template<typename F>
+	void forEachNeighborCell(int segmentIndex, F function) const {
+		int cellIndex = cellOfSegment[segmentIndex];
+		int cellX = cellIndex % numberOfCells(0);
+		int cellY = (cellIndex / numberOfCells(0)) % numberOfCells(1);
+		int cellZ = cellIndex / (numberOfCells(0) * numberOfCells(1));
+
+		for (int z = std::max(cellZ - 1, 0); z <= std::min(cellZ + 1, numberOfCells(2) - 1); z++) {
+			for (int y = std::max(cellY - 1, 0); y <= std::min(cellY + 1, numberOfCells(1) - 1); y++) {
+				for (int x = std::max(cellX - 1, 0); x <= std::min(cellX + 1, numberOfCells(0) - 1); x++) {
+					int neighborCellIndex = (z * numberOfCells(1) + y) * numberOfCells(0) + x;
+					int numberOfSegmentsInCell = firstSegmentOfCell[neighborCellIndex + 1] - firstSegmentOfCell[neighborCellIndex];
+					if (numberOfSegmentsInCell > 0)
+						function(firstSegmentOfCell[neighborCellIndex], numberOfSegmentsInCell);
+				}
+			}
+		}
+	}
+
+	void clear() {
+		*this = sigmaAveragingGeometry();
+	}
+};
+
 struct molecule {
 	/* segment properties */
+	// the segment types while the molecule is averaged and clustered, moved into profile by finishSegmentProfile
 	segmentTypeCollection segments;
+	segmentProfile profile;
 
 	molecule() {
 		segments = segmentTypeCollection(1);
@@ -306,11 +643,20 @@ struct molecule {
 	double Area;
 	double Volume;
 	double epsilonInfinityTotalEnergy;
-	double molarVolumeAt25C;
+	double molarVolumeAt25C = 0; // only calculated if solvation energies are calculated
 
 	signed char moleculeCharge;
 	unsigned short moleculeGroup;
 
+	sigmaAveragingGeometry averagingGeometry;
+
+	// only set if a cutoff is used in the sigma averaging
+	double maximumSigmaAveragingDeviation = 0;
+
+	// only set if the sigma grid is coarsened
+	int numberOfSegmentTypesOnFullSigmaGrid = 0;
+	double relativeSecondSigmaMomentDeviation = 0;
+
 	// Possible groups
 	/*
 	0 monoatomic neutral
@@ -335,6 +681,12 @@ struct molecule {
 	Eigen::VectorXd segmentAreas;
 	Eigen::VectorXd segmentSigmas;
 
+	// the calculations read the segment types from the compact profile only
+	void finishSegmentProfile(segmentProfileArena& arena) {
+		profile.assign(segments, arena);
+		segments = segmentTypeCollection(1);
+	}
+
 	void clear_unneeded_matrices(bool keepDataNeededForReloadingSigmaProfile = false) {
 		atomPositions.resize(0, 0);
 		atomRadii.resize(0);
@@ -348,6 +700,7 @@ struct molecule {
 			segmentHydrogenBondingType.resize(0);
 			segmentAreas.resize(0);
 			segmentSigmas.resize(0);
+			averagingGeometry.clear();
 		}
 
 	}
@@ -417,62 +770,90 @@ struct calculation {
 
 	size_t originalNumberOfCalculations;
 
-	int addOrFindTauIndexForConditions(float temperature) {
-
-		int index = -1;
-
-		for (int i = 0; i < TauTemperatures.size(); i++) {
-			if (TauTemperatures[i] == temperature) {
+private:
 
-				index = i;
-				break;
+	// hashes the exact values so that the index finds the same entries as comparing with ==
+	struct concentrationHash {
+		size_t operator()(const std::vector<float>& key) const {
+			size_t hash = key.size();
+			for (float value : key) {
+				// -0.0f == 0.0f has to result in the same hash
+				hash ^= std::hash<float>()(value == 0.0f ? 0.0f : value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
 			}
+			return hash;
 		}
+	};
 
-		if (index == -1) {
-			TauTemperatures.push_back(temperature);
-			TauConcentrationIndices.push_back(std::vector<int>());
+	std::unordered_map<std::vector<float>, int, concentrationHash> concentrationIndex;
+	std::unordered_map<std::vector<float>, int, concentrationHash> requestConcentrationIndex;
+	std::pair<int, int> indexedRequestConcentrations = std::make_pair(-1, 0);
+	std::unordered_map<float, int> TauIndexForTemperature;
 
-			index = int(TauTemperatures.size()) - 1;
+public:
+
+	int addOrFindTauIndexForConditions(float temperature) {
+
+		auto it = TauIndexForTemperature.find(temperature);
+
+		if (it != TauIndexForTemperature.end()) {
+			return it->second;
 		}
 
+		TauTemperatures.push_back(temperature);
+		TauConcentrationIndices.push_back(std::vector<int>());
+
+		int index = int(TauTemperatures.size()) - 1;
+		TauIndexForTemperature.emplace(temperature, index);
+
 		return index;
 	}
 
-	int addOrFindArrayIndexForConcentration(std::vector<float> concentration, float temperature)
+	// The concentrations of the requests merged into this calculation are only found for the reference states of the same request,
+	// so that reloading the concentrations of a request does not change the reference states of other requests.
+	// The concentrations added for reference states are shared by all requests.
+	int addOrFindArrayIndexForConcentration(std::vector<float> concentration, float temperature, int firstConcentrationOfRequest, int numberOfConcentrationsOfRequest)
 	{
-		int index = -1;
-		int nConditions = 1; // only temperature
-		for (int i = 0; i < concentrations.size(); i++) {
-			int nEqual = 0;
-			for (int j = 0; j < concentration.size(); j++) {
-				if (concentrations[i][j] == concentration[j]) {
-					nEqual++;
-				}
+		// the last entry of the key is the temperature
+		std::vector<float> key = concentration;
+		key.push_back(temperature);
+
+		// keeping the first occurence of a concentration like a linear search would
+		if (indexedRequestConcentrations != std::make_pair(firstConcentrationOfRequest, numberOfConcentrationsOfRequest)) {
+			requestConcentrationIndex.clear();
+			for (int i = firstConcentrationOfRequest; i < firstConcentrationOfRequest + numberOfConcentrationsOfRequest; i++) {
+				std::vector<float> requestKey = concentrations[i];
+				requestKey.push_back(temperatures[i]);
+				requestConcentrationIndex.emplace(std::move(requestKey), i);
 			}
+			indexedRequestConcentrations = std::make_pair(firstConcentrationOfRequest, numberOfConcentrationsOfRequest);
+		}
 
-			// temperature
-			if (temperatures[i] == temperature) {
-				nEqual++;
-			}
+		auto it = requestConcentrationIndex.find(key);
+		if (it != requestConcentrationIndex.end()) {
+			return it->second;
+		}
 
-			// if concentrations and conditions the same, we found the guy
-			if (nEqual == concentration.size() + nConditions) {
-				index = i;
-				break;
-			}
+		it = concentrationIndex.find(key);
+		if (it != concentrationIndex.end()) {
+			return it->second;
 		}
 
-		if (index == -1) {
-			concentrations.push_back(std::move(concentration));
-			temperatures.push_back(temperature);
+		concentrations.push_back(std::move(concentration));
+		temperatures.push_back(temperature);
 
-			index = int(concentrations.size()) - 1;
-		}
+		int index = int(concentrations.size()) - 1;
+		concentrationIndex.emplace(std::move(key), index);
 
 		return index;
 	}
 
+	// the index is not valid anymore after the concentrations were reordered
+	void clearConcentrationIndex() {
+		concentrationIndex = std::unordered_map<std::vector<float>, int, concentrationHash>();
+		requestConcentrationIndex = std::unordered_map<std::vector<float>, int, concentrationHash>();
+		indexedRequestConcentrations = std::make_pair(-1, 0);
+	}
+
 	void shrink_to_fit() {
 
 		for (int i = 0; i < concentrations.size(); i++) {
@@ -503,6 +884,150 @@ struct calculation {
 	}
 };
 
+/* calculations requested with identical components are merged into one calculation when loading,
+   this maps a requested calculation to its concentrations inside the merged calculation */
+struct calculationRequest {
+	int calculationIndex;
+	int firstConcentrationIndex;
+	int numberOfConcentrations;
+};
+
+/* identifies a mixture state independent of the calculation it belongs to:
+   the molecules with non-zero concentration, their concentrations and the temperature */
+struct solvedStateKey {
+
+	std::vector<std::pair<std::uintptr_t, float>> composition;
+	float temperature = 0;
+
+	solvedStateKey() {}
+
+	solvedStateKey(calculation& _calculation, int concentrationIndex) {
+
+		temperature = _calculation.temperatures[concentrationIndex];
+
+		for (int m = 0; m < _calculation.components.size(); m++) {
+			float concentration = _calculation.concentrations[concentrationIndex][m];
+			if (concentration != 0) {
+				composition.push_back(std::make_pair(reinterpret_cast<std::uintptr_t>(_calculation.components[m].get()), concentration));
+			}
+		}
+		std::sort(composition.begin(), composition.end());
+	}
+
+	bool operator<(const solvedStateKey& other) const {
+		if (temperature != other.temperature) {
+			return temperature < other.temperature;
+		}
+		return composition < other.composition;
+	}
+};
+
+/* converged segment gammas and molecular ln(gamma) of the states solved during one call of calculate.
+   The cache is cleared at the beginning of every call of calculate, so that all entries were calculated
+   with the same set of parameters. Only states occuring more than once are stored.
+   Every repeated state is solved by its first occurence before the other calculations read it,
+   so that the results do not depend on the order in which the threads reach a state. */
+class solvedStatesCache {
+
+	// group, sigma, sigmaCorr, HB type and atomic number of a segment type
+	typedef std::tuple<unsigned short, float, float, unsigned short, unsigned short> segmentTypeDescriptor;
+
+	struct solvedState {
+		std::map<segmentTypeDescriptor, float> segmentGammas;
+		std::unordered_map<const molecule*, float> lnGammaMolecules;
+	};
+
+	struct stateOccurences {
+		int numberOfOccurences = 0;
+		const calculation* solvingCalculation = nullptr;
+		int solvingConcentrationIndex = -1;
+	};
+
+	std::map<solvedStateKey, stateOccurences> occurences;
+	std::map<solvedStateKey, solvedState> states;
+	std::mutex Lock;
+
+	static segmentTypeDescriptor getDescriptor(segmentTypeCollection& segments, int index) {
+		return std::make_tuple(segments.SegmentTypeGroup[index], segments.SegmentTypeSigma[index], segments.SegmentTypeSigmaCorr[index],
+			segments.SegmentTypeHBtype[index], segments.SegmentTypeAtomicNumber[index]);
+	}
+
+public:
+
+	void clear() {
+		std::unique_lock<std::mutex> guard(this->Lock);
+		occurences.clear();
+		states.clear();
+	}
+
+	// the first occurence added solves the state
+	void addOccurence(const solvedStateKey& key, const calculation& _calculation, int concentrationIndex) {
+		std::unique_lock<std::mutex> guard(this->Lock);
+		stateOccurences& stateOccurence = occurences[key];
+		if (stateOccurence.numberOfOccurences == 0) {
+			stateOccurence.solvingCalculation = &_calculation;
+			stateOccurence.solvingConcentrationIndex = concentrationIndex;
+		}
+		stateOccurence.numberOfOccurences += 1;
+	}
+
+	bool isRepeated(const solvedStateKey& key) {
+		std::unique_lock<std::mutex> guard(this->Lock);
+		auto it = occurences.find(key);
+		return it != occurences.end() && it->second.numberOfOccurences > 1;
+	}
+
+	bool isSolvedBy(const solvedStateKey& key, const calculation& _calculation, int concentrationIndex) {
+		std::unique_lock<std::mutex> guard(this->Lock);
+		auto it = occurences.find(key);
+		return it != occurences.end() && it->second.numberOfOccurences > 1
+			&& it->second.solvingCalculation == &_calculation && it->second.solvingConcentrationIndex == concentrationIndex;
+	}
+
+	// initializes the segment gammas with the cached solution if available.
+	// returns true if the molecular ln(gamma) of all components could be taken from the cache
+	bool find(const solvedStateKey& key, calculation& _calculation, float* gammas, Eigen::MatrixXf& lnGammaMolecule, int concentrationIndex) {
+		std::unique_lock<std::mutex> guard(this->Lock);
+
+		auto it = states.find(key);
+		if (it == states.end()) {
+			return false;
+		}
+
+		for (int k = 0; k < _calculation.segments.size(); k++) {
+			auto itGamma = it->second.segmentGammas.find(getDescriptor(_calculation.segments, k));
+			if (itGamma != it->second.segmentGammas.end()) {
+				gammas[k] = itGamma->second;
+			}
+		}
+
+		for (int j = 0; j < _calculation.components.size(); j++) {
+			if (it->second.lnGammaMolecules.find(_calculation.components[j].get()) == it->second.lnGammaMolecules.end()) {
+				return false;
+			}
+		}
+
+		for (int j = 0; j < _calculation.components.size(); j++) {
+			lnGammaMolecule(concentrationIndex, j) = it->second.lnGammaMolecules[_calculation.components[j].get()];
+		}
+		return true;
+	}
+
+	void store(const solvedStateKey& key, calculation& _calculation, const float* gammas, Eigen::MatrixXf& lnGammaMolecule, int concentrationIndex) {
+		std::unique_lock<std::mutex> guard(this->Lock);
+
+		solvedState& state = states[key];
+
+		for (int k = 0; k < _calculation.segments.size(); k++) {
+			state.segmentGammas[getDescriptor(_calculation.segments, k)] = gammas[k];
+		}
+
+		for (int j = 0; j < _calculation.components.size(); j++) {
+			state.lnGammaMolecules[_calculation.components[j].get()] = lnGammaMolecule(concentrationIndex, j);
+		}
+	}
+};
+
 /* this class is needed to catch exceptions in the OPENMP threads and rethrow them after the parallel section */
 class threadException {
 	std::exception_ptr Ptr;